@@ -6,6 +6,21 @@
 #include <fstream>
 #include <iomanip>
 #include <map>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <regex>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lexer.hpp"
+#include "objfile.hpp"
 
 using namespace std;
 
@@ -13,14 +28,38 @@ class Assembler{
   
   public:
 
-    Assembler(string input, string output);
+    Assembler(string input, string output, ostream &messages = cout);
+    ~Assembler();
     
-    void assemble();
+    bool assemble(); // false if the input has errors
+
+    // unchanged sources are copied from the cache instead of being assembled again
+    void setCacheDirectory(string directory);
+    // statements are visited once, the object file is the same as with two passes
+    void setSinglePass(bool enabled);
 
   private:
 
     bool firstPass();
     bool secondPass();
+    bool processStatementFirstPass(const Statement &statement); // false at the end of the file
+    bool processStatementSecondPass(const Statement &statement); // false at the end of the file
+
+    // single pass: statements whose encoding depends on the final section lengths, the literal pool or
+    // symbols defined later leave zeroed space and are revisited once the whole file is read
+    struct Fixup{
+      const Statement *statement;
+      uint32_t location; // location counter at the start of the statement
+    };
+
+    bool singlePassMode = false;
+    vector<Fixup> fixups;
+
+    bool singlePass();
+    bool resolveFixups();
+    bool needsFixup(const Statement &statement);
+    bool referencesSymbolOrPool(const Operand &operand); // memory operand other than a register
+    // or a register with a literal offset
 
     // first pass processing
     void processGlobalDeclaration(string label);
@@ -29,17 +68,54 @@ class Assembler{
     void processWordDeclaration();
     void processSkipDeclaration(string literal);
     void processASCIIDeclaration(string str);
-    void processEquDeclaration(string label, string value);
+    void processEquDeclaration(string label, const vector<Operand> &expression, uint32_t line);
     void processEndDeclaration();
     void processLabelDeclaration(string label);
-    void processInstruction(string line);
+    void processInstruction(const Statement &statement);
+
+    // .equ expressions are kept as trees and evaluated after the first pass, each once and after the
+    // symbols it depends on; the result is a constant or an offset from a label, relocated like a label
+    struct ExpressionNode{
+      char operation;     // + - * / for an operation, 0 for a literal or a symbol
+      string_view symbol; // empty for a literal
+      int32_t value;      // of a literal
+      int32_t left;       // operands of an operation
+      int32_t right;
+    };
+
+    struct EquDefinition{
+      uint32_t symbol;
+      uint32_t firstNode; // nodes of the expression, the root is the last one
+      int32_t root;
+      uint32_t line;
+    };
+
+    struct ExpressionValue{
+      int32_t value;
+      int32_t section; // absolute section for a constant, otherwise the value is an offset in the section
+    };
+
+    enum EquState{
+      UnvisitedEqu,
+      VisitedEqu, // its dependencies are being ordered
+      OrderedEqu
+    };
+
+    vector<ExpressionNode> expressionNodes;
+    vector<EquDefinition> equDefinitions;
+    unordered_map<uint32_t, uint32_t> equIndex; // definition of each .equ symbol
+
+    int32_t insertExpressionNode(ExpressionNode node);
+    int32_t buildExpression(const vector<Operand> &expression); // returns the root node
+    bool evaluateEquDefinitions();
+    bool orderEquDefinition(uint32_t definition, vector<uint8_t> &state, vector<uint32_t> &order);
+    bool evaluateExpression(int32_t node, ExpressionValue &result);
 
-    int32_t calculateExpression(string expression); // calculates the expression, returning a value
-    // or leaving a relocation for linker to resolve
     void processSectionEnding(); // position the pool at the end of the section
     
     int32_t getValue(string literal);
     void updatePool();
+    void insertLiteral(string literal); // adds a literal to the pool of the current section, once
 
     // second pass processing
 
@@ -47,8 +123,7 @@ class Assembler{
     void processWordDeclarationSecondPass(string parameter);
     void processSkipDeclarationSecondPass(string literal);
     void processASCIIDeclarationSecondPass(string str);
-    void processInstructionSecondPass(string line);
-    void processEquDeclarationSecondPass(string label, string value);
+    void processInstructionSecondPass(const Statement &statement);
     
     int32_t setAbsoluteJump(string addr);
     uint32_t findSymbolLocationInLiteralPool(string symbol); // returns the symbol's address in the pool of literals
@@ -63,9 +138,24 @@ class Assembler{
     uint8_t const registerZero = 0;
     uint8_t const registerSP = 14;
 
-    void processCode(); // processes set input file
+    void readSource(); // maps set input file
+    void unmapSource();
+    void processCode(); // parses the source
     void generateOutput(); //generates a textual representation of object file
     void generateBinary();  //generates binary file for further processing
+    string getTextOutputPath();
+
+    // cache entries are named by a hash of the source and of the assembler executable, so a rebuilt
+    // assembler never reuses entries of an older one; bump the version when the output for the same
+    // source changes, in case the executable can't be read
+    uint32_t const CacheVersion = 2;
+    string cacheDirectory; // empty if the cache is not used
+    string cacheKey;
+
+    bool fetchFromCache(); // copies the outputs from the cache, false if they are not there
+    void storeInCache();
+    static void mixHash(uint64_t &hash, const void *bytes, size_t size); // 64 bit FNV-1a
+    static uint64_t getExecutableHash(); // 0 if the executable can't be read
 
     uint32_t locationCounter;
     int32_t currentSection = -1;
@@ -73,15 +163,23 @@ class Assembler{
 
     uint8_t const AbsoluteSectionIndex = 1;
     uint8_t const UndefinedSectionIndex = 0;
+    // half of the address space, offsets in a section and its literal pool never wrap around
+    uint32_t const MaxSectionSize = 0x80000000;
 
     uint16_t currentSectionIndex = 0;
     uint32_t currentSymbolIndex  = 0;
 
     string inputPath;
     string outputPath;
+    ostream &messages; // errors and progress of this assembler
 
-    vector<string> inputCode;
-    uint32_t currentLine;
+    // the source is mapped, tokens and statements are views into the mapping; files that can't be
+    // mapped (pipes) are read into the buffer instead
+    string_view sourceCode;
+    void *sourceMapping = nullptr;
+    size_t sourceMappingSize = 0;
+    string sourceBuffer;
+    vector<Statement> statements; // parsed once, used by both passes
 
     struct SymbolDefinition{
       string label;
@@ -111,11 +209,24 @@ class Assembler{
       string name;
       int32_t base;
       uint32_t length;
-      map<uint32_t, uint8_t> data;
+      vector<uint8_t> data; // grows with the location counter, gaps are zero
       vector<LiteralsTable> literalPool; 
+      unordered_map<string, uint32_t> literalIndex;    // pool entry of each literal or symbol
+      unordered_map<uint32_t, uint32_t> relocationIndex; // relocation table entry at each offset
     };
 
     vector<SymbolDefinition> SymbolTable;
+    // symbols by label, in the order of their first appearance in the table
+    unordered_set<string> symbolLabels;
+    unordered_map<string_view, uint32_t> symbolIndex;
+
+    int32_t findSymbol(string_view label); // -1 if the symbol isn't declared
+    void insertSymbol(SymbolDefinition symbol); // appends the symbol to the table and indexes it
+    void writeData(uint32_t section, uint32_t location, const uint8_t *bytes, uint32_t size);
+    void writeWord(uint32_t section, uint32_t location, uint32_t value); // little endian
+    void reserveData(uint32_t section, uint32_t end); // zero fills the section up to end
+    void insertPoolEntry(LiteralsTable entry); // appends the entry to the current section's pool and indexes it
+    bool insertRelocation(RelocationDefinition reloc); // false if the location is already relocated
     vector<SectionDefinition> SectionTable;
     vector<RelocationDefinition> RelocationTable;
 
@@ -10,6 +10,18 @@
 #include <chrono>
 #include <unistd.h>
 #include <signal.h>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <algorithm>
 
 using namespace std;
 
@@ -82,12 +94,65 @@ class Emulator{
   // solely on operand values
 
   // Memory
-  map<uint32_t, int8_t> memory;   
+  // guest memory is a two-level page table of lazily allocated pages, a page is allocated on the
+  // first write into it, while reading a byte that was never written still results in a fault
+  static const uint32_t PAGE_BITS = 12;
+  static const uint32_t PAGE_SIZE = 1 << PAGE_BITS; // 4 KiB
+  static const uint32_t PAGE_MASK = PAGE_SIZE - 1;
+  static const uint32_t TABLE_BITS = 10; // pages per second level table
+  static const uint32_t TABLE_SIZE = 1 << TABLE_BITS;
+  static const uint32_t DIRECTORY_SIZE = 1 << (32 - PAGE_BITS - TABLE_BITS);
+
+  typedef bool (Emulator::*Handler)(); // executes the currently decoded instruction
+
+  // an already validated instruction, cached by the address it was fetched from
+  struct DecodedInstruction{
+    bool valid;
+    uint8_t op;
+    uint8_t regA;
+    uint8_t regB;
+    uint8_t regC;
+    int16_t displacement;
+    bool ldMem;
+    bool iret;
+    uint8_t size; // in bytes, 8 for the fused load from memory and iret pairs
+    Handler handler;
+  };
+
+  struct Page{
+    int8_t data[PAGE_SIZE];
+    uint64_t mapped[PAGE_SIZE / 64]; // one bit per byte, set once the byte is written
+    unique_ptr<DecodedInstruction[]> decoded; // one entry per word, allocated once code is
+    // fetched from the page
+    uint64_t translated[PAGE_SIZE / 64]; // bytes that translated basic blocks depend on
+  };
+
+  struct PageTable{
+    unique_ptr<Page> pages[TABLE_SIZE];
+  };
+
+  unique_ptr<PageTable> pageDirectory[DIRECTORY_SIZE];
+
+  Page *findPage(uint32_t address); // returns nullptr if the page was never allocated
+  Page *allocatePage(uint32_t address); // returns the page, allocating it if necessary
+  bool isMapped(Page *page, uint32_t address);
+  void setMapped(Page *page, uint32_t address);
+  void setMappedRange(Page *page, uint32_t offset, uint32_t size);
 
   int8_t readMem(uint32_t address);  // reads a single addressible unit 
   int32_t readMemWord(uint32_t address); // reads a word(4 addressible units)     
   void writeMem(int8_t value, uint32_t address);  // writes value in a single addressible unit 
   void writeMemWord(int32_t value, uint32_t address); // writes a word
+
+  // words inside a single page are accessed directly, the rest go through byte accesses
+  bool isWordMapped(Page *page, uint32_t offset);
+  void invalidateTranslated(Page *page, uint32_t address, uint32_t size);
+
+  // memory mapped registers, writes into the register window are dispatched through this table
+  typedef void (Emulator::*MmioHandler)(int8_t value);
+  MmioHandler mmioHandlers[256]; // indexed by offset from the start of the window
+
+  void setupMmio();
   
   const uint32_t MEMORY_SIZE = UINT32_MAX; 
   const uint32_t MEMORY_MAPPED_REGISTERS_ADDRESS = 0xFFFFFF00; // simultaneously the start of stack
@@ -96,9 +161,15 @@ class Emulator{
   struct Segment{
     uint32_t virtualAddress; 
     uint32_t size; // in bytes
-    vector<int8_t> data;   
+    const int8_t *data; // points into the mapped input file
   };
 
+  // the input file is mapped instead of read, segments are copied page by page straight from it
+  const int8_t *image;
+  size_t imageSize;
+
+  void unmapImage();
+
   // Registers
 
   const uint8_t GPR_NUMBER = 16;   // number of general purpose registers 
@@ -138,9 +209,94 @@ class Emulator{
 
   uint32_t currentPC; // holds the previous pcs value;
 
-  bool fetchAndDecodeInstruction();
+  bool fetchAndDecodeInstruction(); // uses the decoded instruction cache when possible
+  bool decodeInstruction(); // reads and validates the instruction at pc
   bool executeInstruction();
 
+  // Execution engines
+  enum Engine{
+    SWITCH_ENGINE,  // dispatches every instruction through the switch in executeInstruction
+    THREADED_ENGINE, // calls the handler stored with the decoded instruction directly
+    BLOCK_ENGINE // executes whole translated basic blocks between interrupt polls
+  };
+
+  Engine engine;
+
+  Handler handlers[256]; // indexed by operation code
+  Handler currentHandler; // handler of the currently decoded instruction
+
+  void setupHandlers();
+
+  // both engines share the handlers, so their architectural results are identical
+  bool executeHalt();
+  bool executeInt();
+  bool executeCall();
+  bool executeBeq();
+  bool executeBne();
+  bool executeBgt();
+  bool executeJmp();
+  bool executePush();
+  bool executePop(); // also ret and iret
+  bool executeAdd();
+  bool executeSub();
+  bool executeMul();
+  bool executeDiv();
+  bool executeAnd();
+  bool executeOr();
+  bool executeXor();
+  bool executeShl();
+  bool executeShr();
+  bool executeXchg();
+  bool executeNot();
+  bool executeLoad(); // register indirect, immediate and memory loads
+  bool executeLoadRegister();
+  bool executeStoreMemory();
+  bool executeStore();
+  bool executeCsrrd();
+  bool executeCsrwr();
+  bool executeIllegal();
+
+  DecodedInstruction *findDecoded(uint32_t address); // nullptr for unaligned addresses
+  void invalidateDecoded(Page *page, uint32_t address); // drops instructions overlapping address
+
+  // Basic blocks
+  enum MicroOpKind{
+    GENERIC_OP,  // executed through its handler, with pc set past the instruction
+    REGISTER_OP, // register to register operation, executed inline without touching pc
+    CONSTANT_OP  // immediate load from the literal pool, folded into a constant
+  };
+
+  struct MicroOp{
+    MicroOpKind kind;
+    DecodedInstruction instruction;
+    uint32_t next; // address of the following instruction
+    int32_t constant; // loaded value of a folded immediate load
+  };
+
+  // a block ends with the first instruction that can change the flow of control, so the
+  // instructions in between are always executed in sequence
+  struct BasicBlock{
+    uint32_t end; // address after the last instruction
+    vector<MicroOp> ops;
+    bool valid; // cleared when memory the block was translated from is overwritten
+  };
+
+  const uint32_t MAX_BLOCK_SIZE = 64; // in instructions, bounds the interrupt latency
+
+  unordered_map<uint32_t, BasicBlock> blocks; // keyed by the address of the first instruction
+  unordered_map<uint32_t, vector<uint32_t>> pageBlocks; // page number -> blocks that depend on it
+  bool blockInvalidated; // set when the running or recorded block has been overwritten
+
+  void runBlock(); // executes the block at pc, translating it first if necessary
+  void translateBlock(); // executes instructions from pc while recording them as a block
+  void executeBlock(BasicBlock &block);
+  bool endsBlock(MicroOp &microOp);
+  void markTranslated(uint32_t address, uint32_t size);
+  void markBlock(BasicBlock &block); // marks every byte the block depends on
+  void indexBlock(uint32_t start, uint32_t address, uint32_t size);
+  bool blockDependsOn(BasicBlock &block, uint32_t address, uint32_t size);
+  void invalidateBlocks(Page *page, uint32_t address, uint32_t size); // all bytes in one page
+
   // Jump conditions
 
   enum StatusFlag
@@ -163,6 +319,12 @@ class Emulator{
   void processSubroutine();   // processes interrupt request
 
   // Timer
+  enum TimerMode{
+    REALTIME_TIMER, // periods are measured with the system clock, sampled every few instructions
+    VIRTUAL_TIMER   // periods are converted into instruction budgets, making runs deterministic
+  };
+
+  TimerMode timerMode;
   bool timerActive; 
 
   int64_t period; // all in milliseconds
@@ -170,8 +332,17 @@ class Emulator{
   int64_t previousTime;
   int64_t currentTime;
 
+  uint64_t executedInstructions; // since the start of emulation
+  uint64_t previousSample; // instruction count at the last sample of the clock
+  uint64_t timerStart; // instruction count at the start of the current virtual period
+
+  uint64_t instructionsPerMs; // speed of the emulated processor in virtual time
+  uint64_t sampleInterval; // in instructions, between two reads of the system clock
+
   void resetTimer(uint32_t value);
+  void writeTimerConfig(int8_t value); // configuring the timer immediately resets it
   void timerTick(); // time passed between two instructions effectively
+  int64_t systemTime(); // in milliseconds
 
   const uint32_t TIM_CFG = 0xFFFFFF10; // mapped configuration register for timer
 
@@ -182,12 +353,85 @@ class Emulator{
   void resetTerminal();
   void readTerminal();
 
+  // input is read by a separate thread into a single producer, single consumer ring buffer,
+  // so the emulation loop only has to compare two counters to find out if a key was pressed
+  static const uint32_t INPUT_BUFFER_SIZE = 256;
+  static constexpr int INPUT_POLL_TIMEOUT = 50; // in milliseconds, bounds the time needed to stop
+
+  char inputBuffer[INPUT_BUFFER_SIZE];
+  atomic<uint32_t> inputHead; // characters written by the input thread
+  atomic<uint32_t> inputTail; // characters consumed by the emulator
+  atomic<bool> inputRunning;
+  thread inputThread;
+
+  void startInput();
+  void stopInput();
+  void inputLoop(); // body of the input thread
+
+  // output written to the terminal is kept in the stdout buffer and flushed on a new line,
+  // when the buffer fills up, once the guest stops writing for a while and on halt
+  static const size_t OUTPUT_BUFFER_SIZE = 4096;
+  const uint64_t OUTPUT_IDLE_INSTRUCTIONS = 1 << 16;
+
+  bool bufferedOutput; // otherwise every character is flushed as soon as it's written
+  bool outputPending;  // characters are waiting in the buffer
+  uint64_t lastOutput; // instruction count at the last write into TERM_OUT
+
+  void writeTerminal(int8_t value);
+  void flushIdleTerminal();
+  void flushTerminal();
+
   const uint32_t TERM_OUT = 0xFFFFFF00; // mapped output register for terminal
   const uint32_t TERM_IN = 0xFFFFFF04;  // mapped input register for terminal
 
   const uint32_t TIMER_CFG = 0xFFFFFF10;  // mapped register for timer configuration
 
 
+  // Profiling
+  // counts executed instructions per pc and operation code, branch outcomes and interrupt entries,
+  // symbols come from the map the linker writes next to the executable
+  struct ProfileSymbol{
+    uint32_t address;
+    uint8_t rank; // among symbols at the same address the one with the highest rank names it
+    string name;
+  };
+
+  struct BranchCount{
+    uint64_t taken;
+    uint64_t notTaken;
+  };
+
+  // calls and interrupt entries form a trie of call stacks, used for the collapsed stack output
+  struct CallNode{
+    uint32_t address; // entry point of the function
+    uint32_t parent;
+    uint64_t count; // instructions executed directly in this function on this stack
+    map<uint32_t, uint32_t> children; // entry point -> node index
+  };
+
+  static const uint32_t PROFILE_HOT_SPOTS = 20; // number of addresses listed in the report
+
+  bool profiling;
+  string profilePrefix; // report files are <prefix>.profile and <prefix>.folded
+
+  vector<ProfileSymbol> profileSymbols; // sorted by address
+  unordered_map<uint32_t, uint64_t> pcCounts;
+  uint64_t opcodeCounts[256];
+  unordered_map<uint32_t, BranchCount> branchCounts;
+  uint64_t interruptCounts[5]; // indexed by cause
+  vector<CallNode> callNodes;
+  uint32_t currentNode;
+
+  void loadSymbolMap();
+  void profileInstruction(); // called before the instruction at currentPC is executed
+  void profileControlFlow(uint32_t next); // called after, next is the address past the instruction
+  void profileInterrupt(); // called on entry into the interrupt handler
+  uint32_t enterCall(uint32_t address);
+  string symbolAt(uint32_t address); // symbol+offset
+  string functionAt(uint32_t address); // name of the symbol containing address
+  string opcodeName(uint8_t code);
+  string callStack(uint32_t node);
+
   // Miscellaneous
   ofstream outputFile;
  
@@ -202,6 +446,9 @@ class Emulator{
 public:
 
   Emulator(string input);
+  ~Emulator();
+
+  bool processOption(string option); // returns false for an unrecognized option
 
   bool processInput();
   bool loadData();  // loads input file data into memory
@@ -209,6 +456,7 @@ public:
   void emulate(); // starts the process of emulation
 
   void generateOutput();
+  void generateProfile(); // writes the profile reports when profiling is on
 
 };
 
@@ -0,0 +1,159 @@
+#ifndef LEXER_HPP
+#define LEXER_HPP
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// Source code is tokenized and parsed into statements once, both passes of the assembler then work
+// on the statements. Texts of tokens and operands are views into the source buffer.
+
+enum TokenKind{
+  IDENTIFIER_TOKEN,  // symbol or mnemonic
+  DIRECTIVE_TOKEN,   // .name
+  NUMBER_TOKEN,      // decimal or hexadecimal literal, the sign is a separate token
+  REGISTER_TOKEN,    // %name
+  STRING_TOKEN,      // "text", including the quotes
+  PUNCTUATION_TOKEN, // one of $ [ ] + - * / , :
+  NEWLINE_TOKEN,
+  END_TOKEN,
+  INVALID_TOKEN
+};
+
+struct Token{
+  TokenKind kind;
+  string_view text;
+};
+
+class Lexer{
+
+  public:
+
+    Lexer(string_view source);
+
+    Token nextToken();
+    uint32_t getLine(); // line of the last returned token, starting from 1
+
+  private:
+
+    string_view source;
+    size_t position;
+    uint32_t line;
+
+    bool isIdentifierStart(char c);
+    bool isIdentifierPart(char c);
+
+    Token makeToken(TokenKind kind, size_t start);
+};
+
+enum StatementKind{
+  LABEL_STATEMENT, // line with nothing but a label
+  GLOBAL_STATEMENT,
+  EXTERN_STATEMENT,
+  SECTION_STATEMENT,
+  WORD_STATEMENT,
+  SKIP_STATEMENT,
+  ASCII_STATEMENT,
+  EQU_STATEMENT,
+  END_STATEMENT,
+  INSTRUCTION_STATEMENT,
+  INVALID_STATEMENT // unknown or malformed, reported as an unrecognized command
+};
+
+enum Mnemonic{
+  HALT_MNEMONIC,
+  INT_MNEMONIC,
+  IRET_MNEMONIC,
+  CALL_MNEMONIC,
+  RET_MNEMONIC,
+  JMP_MNEMONIC,
+  BEQ_MNEMONIC,
+  BNE_MNEMONIC,
+  BGT_MNEMONIC,
+  PUSH_MNEMONIC,
+  POP_MNEMONIC,
+  XCHG_MNEMONIC,
+  ADD_MNEMONIC,
+  SUB_MNEMONIC,
+  MUL_MNEMONIC,
+  DIV_MNEMONIC,
+  NOT_MNEMONIC,
+  AND_MNEMONIC,
+  OR_MNEMONIC,
+  XOR_MNEMONIC,
+  SHL_MNEMONIC,
+  SHR_MNEMONIC,
+  LD_MNEMONIC,
+  ST_MNEMONIC,
+  CSRRD_MNEMONIC,
+  CSRWR_MNEMONIC
+};
+
+// operand kinds are bit flags so the instruction table can list every kind allowed in a position
+enum OperandKind{
+  GPR_OPERAND = 0x1,        // %r0-%r15, %sp, %pc
+  CSR_OPERAND = 0x2,        // %status, %handler, %cause
+  LITERAL_OPERAND = 0x4,    // memory operand or jump target given as a literal
+  SYMBOL_OPERAND = 0x8,     // memory operand or jump target given as a symbol
+  IMMEDIATE_LITERAL = 0x10, // $literal
+  IMMEDIATE_SYMBOL = 0x20,  // $symbol
+  REGISTER_INDIRECT = 0x40, // [%reg] or [%reg + literal/symbol]
+  STRING_OPERAND = 0x80
+};
+
+struct Operand{
+  OperandKind kind;
+  string_view text;   // register with %, literal or symbol without $, or string with quotes
+  string_view offset; // offset of a register indirect operand, empty if there is none
+  char operation;     // operation preceding a term of an expression, 0 for the first term
+};
+
+struct Statement{
+  uint32_t line = 0;
+  string_view label; // empty if the line has no label
+  StatementKind kind = INVALID_STATEMENT;
+  Mnemonic mnemonic = HALT_MNEMONIC; // for instructions
+  vector<Operand> operands;
+  vector<Operand> expression; // terms of the .equ expression
+};
+
+class Parser{
+
+  public:
+
+    Parser(string_view source);
+
+    void parse(vector<Statement> &statements);
+
+  private:
+
+    struct InstructionFormat{
+      const char *name;
+      Mnemonic mnemonic;
+      uint8_t operandCount;
+      uint8_t operands[3]; // allowed operand kinds for each position
+    };
+
+    static const InstructionFormat instructionFormats[];
+
+    Lexer lexer;
+    vector<Token> tokens; // tokens of the line being parsed
+
+    void parseLine(Statement &statement);
+    void parseDirective(Statement &statement, size_t index);
+    void parseInstruction(Statement &statement, size_t index);
+
+    bool parseOperand(size_t &index, Operand &operand);
+    bool parseOperandList(size_t index, vector<Operand> &operands);
+    bool parseExpression(size_t index, vector<Operand> &expression);
+    bool parseLiteral(size_t &index, string_view &text); // literal with an optional minus sign
+
+    bool isPunctuation(size_t index, char c);
+    bool isAdjacent(size_t index); // the token starts right where the previous one ends
+    bool isGeneralRegister(string_view name);
+    bool isControlRegister(string_view name);
+};
+
+#endif
@@ -6,6 +6,17 @@
 #include <fstream>
 #include <iomanip>
 #include <map>
+#include <vector>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <algorithm>
+#include "objfile.hpp"
 
 using namespace std;
 
@@ -43,7 +54,10 @@ class Linker{
       string name;
       int32_t base;
       uint32_t length; 
-      map<uint32_t, uint8_t> data;
+      // input sections: length bytes at dataOffset in the data of their file (fileData)
+      // aggregated sections: length bytes owned by the section, starting at the virtual address
+      uint32_t dataOffset;
+      vector<uint8_t> data;
  
       uint32_t aggregateIndex; // used for navigation through aggregated sections
       uint32_t virtualAddress;
@@ -59,8 +73,13 @@ class Linker{
     vector<vector<SymbolDefinition>> SymbolTables;
     vector<vector<SectionDefinition>> SectionTables;
     vector<vector<RelocationDefinition>> RelocationTables;
+    vector<vector<uint8_t>> fileData; // section contents of every input file, released after aggregation
     vector<MappedSection> mappedSections;
-    map<string, SymbolDefinition > extractedSymbols;
+    // labels of AggregatedSymbolTable are interned, the index keys stay valid while the table grows
+    unordered_set<string> symbolLabels;
+    // symbols every file can see: globals, externs, section symbols, UND and ABS. A local symbol is
+    // visible only in its own file, aggregatedIndex of the file's symbol table entry points to it.
+    unordered_map<string_view, uint32_t> globalSymbols;
     vector<string> inputFiles;
 
     vector<SymbolDefinition> AggregatedSymbolTable;
@@ -68,14 +87,24 @@ class Linker{
     vector<RelocationDefinition> AggregatedRelocationTable;
 
     bool relocatable;
+    bool fillGaps; // sections without -place= go into the smallest free gap they fit in
     bool errorDetected;
+    uint32_t threads; // workers used for reading files, merging data and resolving relocations
     bool fileEnd;
     string outputFile;
 
     uint32_t const AbsoluteSectionIndex = 1;
     uint32_t const UndefinedSectionIndex = 0;
+    uint32_t const SectionAlignment = 4; // for sections placed by the linker
+    uint64_t const MemoryMappedRegistersAddress = 0xFFFFFF00; // end of memory available for sections
 
-    bool processInputFiles(); // extracts data from input files
+    // runs task for every index below count, spread over the worker threads
+    void parallelFor(uint32_t count, function<void(uint32_t)> task);
+
+    bool processInputFiles(); // extracts data from input files, several files are read in parallel
+    bool readInputFile(uint32_t file); // fills the tables of the file, safe to call concurrently for different files
+    bool readObjectFile(ifstream &inputFile, uint32_t file); // version 2 object file, after the magic
+    bool readLegacyObjectFile(ifstream &inputFile, uint32_t file);
 
     // combines and connects symbols, sections, data and relocations of the same section
     void aggregateSectionTables(); 
@@ -85,7 +114,6 @@ class Linker{
 
     void allocateSection(); // sets the addresses of sections in memory
 
-    bool overlapingSections(MappedSection s1, MappedSection s2);// checks if section spaces overlap
 
     void resolveRelocations(); // completes relocations and loads data
 
@@ -94,6 +122,7 @@ class Linker{
     void generateBinaryExe(); // generates a binary exe for emulation
     void generateExe(); // generates an executable file in text format
     void generateObjTxt(); // generates an object file for further linking
+    void generateSymbolMap(); // writes symbol addresses of the executable, used by the emulator profiler
 
     public:
     // processes the input command, if proper
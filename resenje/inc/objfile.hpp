@@ -0,0 +1,62 @@
+#ifndef OBJFILE_HPP
+#define OBJFILE_HPP
+#include <cstdint>
+
+// Object file format written by the assembler and the linker (-relocatable).
+//
+// version 2, all fields little endian:
+//   ObjHeader
+//   string table    stringTableSize bytes of zero terminated names
+//   ObjSymbol       x symbols
+//   ObjSection      x sections
+//   section data    length bytes of every section, in the order of the section records
+//   ObjRelocation   x relocations
+//
+// Files that don't start with the magic are in the legacy format: symbol count followed by
+// symbols, section count followed by sections with every data byte preceded by its address,
+// relocation count followed by relocations. The linker still reads them.
+
+const char OBJ_MAGIC[4] = {'\x7f', 'O', 'B', 'J'};
+const uint32_t OBJ_VERSION = 2;
+
+struct ObjHeader{
+  char magic[4];
+  uint32_t version;
+  uint32_t symbols;
+  uint32_t sections;
+  uint32_t relocations;
+  uint32_t stringTableSize;
+};
+
+struct ObjSymbol{
+  uint32_t name; // offset in the string table
+  uint32_t section;
+  int32_t value;
+  uint8_t global;
+  uint8_t external;
+  uint8_t defined;
+  uint8_t reserved;
+};
+
+struct ObjSection{
+  uint32_t name; // offset in the string table
+  int32_t base;
+  uint32_t length;
+};
+
+enum ObjRelocationType{
+  R_X86_64_32_TYPE // the only relocation in use, absolute 32 bit address
+};
+
+struct ObjRelocation{
+  uint32_t section;
+  uint32_t offset;
+  uint32_t symbolIndex;
+  int32_t addend;
+  uint32_t type;
+};
+
+static_assert(sizeof(ObjHeader) == 24 && sizeof(ObjSymbol) == 16 && sizeof(ObjSection) == 12
+  && sizeof(ObjRelocation) == 20, "object file records must not be padded");
+
+#endif
@@ -1,273 +1,317 @@
 #include "../inc/assembler.hpp"
-#include"../misc/regex.hpp"
 
 
 
-Assembler::Assembler(string input, string output) : inputPath(input), outputPath(output){
+Assembler::Assembler(string input, string output, ostream &messages) :
+  inputPath(input), outputPath(output), messages(messages){
 
   SectionDefinition undefinedSection = {"UNDEFINED", 0, 0};
   SectionDefinition absSection = {"ABSOLUTE", 0, 0};
   SectionTable.insert(SectionTable.begin() + currentSectionIndex++, undefinedSection);
   SectionTable.insert(SectionTable.begin() + currentSectionIndex++, absSection);
   SymbolDefinition undefSymbol = {"UND", 0, 0, false, false, true };
-  SymbolTable.push_back(undefSymbol);
+  insertSymbol(undefSymbol);
   currentSymbolIndex++;
   SymbolDefinition absSymbol = {"ABS", 1, 0x0, false, false, true};
-  SymbolTable.insert(SymbolTable.begin() + currentSymbolIndex++, absSymbol);
+  insertSymbol(absSymbol);
+  currentSymbolIndex++;
 
   currentSection = 1;
   currentSymbol = 0;
   errorDetected = false;
   locationCounter = 0;
 
-  cout<<"Input file: "<<this->inputPath<<endl;
+  messages<<"Input file: "<<this->inputPath<<endl;
+}
+
+Assembler::~Assembler(){
+  unmapSource();
 }
 
-void Assembler::assemble(){
+bool Assembler::assemble(){
    
+readSource();
+if(fetchFromCache()) return true;
+
 processCode();  
   
-//first pass
-if(firstPass()) //if successful, proceed
-  if(secondPass()){
+//first and second pass, or a single pass with fixups
+if(singlePassMode ? singlePass() : firstPass() && secondPass()){ //if successful, proceed
 
-    cout<< "Sucessfully compiled."<< endl;
+    messages<< "Sucessfully compiled."<< endl;
     
     // generates .o and .txt file upon successful compilation
     generateBinary();
     generateOutput();
-    return;
+    storeInCache();
+    return true;
   }
 
-cout<< "Error during compilation."<<endl;   
-cout<<endl;
-
+messages<< "Error during compilation."<<endl;   
+messages<<endl;
+return false;
 }
 
 
 bool Assembler::firstPass(){
 
-  currentLine = 0;
-  for(auto line = 0; line < inputCode.size(); line++){
-
-    smatch atoms;
-    string code = inputCode[line];
+  for(const Statement &statement: statements){
 
-    if(regex_match(code, regNewline)) continue;
+    bool more = processStatementFirstPass(statement);
 
-    code = regex_replace(code, regComment, "");
-    code = regex_replace(code, regTabs, "");
-    code = regex_replace(code, regEmptySpace, "");
+    if(errorDetected) {
+      messages<<"Error at line " << statement.line << "." << endl;
+      
+      return false;
+    }
+    if(!more) break;
+  }
+  
+    updatePool();
+    return evaluateEquDefinitions();
+    
+}
 
-    if(code.length() == 0) continue;
+bool Assembler::secondPass(){
 
-    if(regex_search(code, atoms, regLabel)){
-      string label = atoms.str(1);
+  for(const Statement &statement: statements){
 
-      processLabelDeclaration(label);
+    bool more = processStatementSecondPass(statement);
 
-      code = atoms.str(2); //additional code will be further processed
+    if(errorDetected) {
+      messages<<"Error at line " << statement.line << "." << endl;
 
-      if(code.length() == 0)
-        continue;
-      
+      return false;
     }
-    if(regex_search(code, atoms, regGlobal)){
+    if(!more) break;
+  }
 
-      string syms = atoms.str(1);
-      stringstream ss(syms);
+  unloadLiteralsPool();
+  return true;
+}
 
-      string symbol;
-      syms ="";
-      
-      while (getline(ss, symbol, ',')) {
-                    
-        for(auto i =0; i< symbol.length(); i++){
-          if (symbol[i] != ' '){
-            syms+= symbol[i];
-          }
-        }
-        processGlobalDeclaration(syms);
-        syms ="";            
-        }
-    }
+bool Assembler::singlePass(){
 
-    else if(regex_search(code, atoms, regExtern)){
-      string syms = atoms.str(1);
-      stringstream ss(syms);
+  bool sectionReopened = false;
+  for(const Statement &statement: statements){
 
-      string symbol;
-      syms ="";
-      while (getline(ss, symbol, ',')) {              
-        for(auto i =0; i< symbol.length(); i++){
-          if (symbol[i] != ' '){
-            syms+= symbol[i];
-          }
-        }
-        processExternDeclaration(syms);
-        syms ="";            
-        }
-    }
-    else if(regex_search(code, atoms, regSection)){
-      
-      string label = atoms.str(1);
-      processSectionDeclaration(label);
-    }
-    else if(regex_search(code, atoms, regWord)){
-      processWordDeclaration();    
-    }
-    else if(regex_search(code, atoms, regSkip)){
-      string literal = atoms.str(1);
-      processSectionDeclaration(literal);    
-    }
-    else if(regex_search(code, atoms, regAscii)){
-      string str = atoms.str(1);
-      processASCIIDeclaration(str);    
-    }
-    else if(regex_search(code, atoms, regEqu)){
-      string label = atoms.str(1);
-      string value = atoms.str(2);
+    uint32_t location = locationCounter;
+    size_t sections = SectionTable.size();
+    bool more = processStatementFirstPass(statement);
 
-      processEquDeclaration(label, value);    
-    }
+    // a reopened section starts again from 0 and overwrites what was emitted before, so from then on
+    // statements are emitted when fixups are resolved, keeping the order of the writes
+    if(statement.kind == SECTION_STATEMENT && SectionTable.size() == sections) sectionReopened = true;
 
-    else if(regex_search(code, atoms, regEnd)){
-      processEndDeclaration();    
-      break;
-    }
-    else if(regex_search(code, atoms, regComment)){
-    }
-    else{
-      processInstruction(code);
+    if(!errorDetected){
+      if(sectionReopened || needsFixup(statement)){
+        fixups.push_back({&statement, location});
+      }
+      else{
+        // nothing that follows changes the encoding, so the statement is emitted right away
+        uint32_t end = locationCounter;
+        locationCounter = location;
+        processStatementSecondPass(statement);
+        locationCounter = end;
+      }
     }
 
     if(errorDetected) {
-      line++;
-      cout<<"Error at line " << line << "." << endl;
-      
+      messages<<"Error at line " << statement.line << "." << endl;
+
       return false;
     }
+    if(!more) break;
   }
-  
-    updatePool();
-    return true;
-    
+
+  updatePool();
+  return evaluateEquDefinitions() && resolveFixups();
 }
 
-bool Assembler::secondPass(){
-  currentLine = 0;
+bool Assembler::resolveFixups(){
 
-  for(auto line = 0; line < inputCode.size(); line++){
-    
-    smatch atoms;
-    string code = inputCode[line];
+  // section lengths and pool locations are final now; fixups are resolved in the order of their
+  // statements, so pool entries and relocations come out in the same order as with two passes
+  for(const Fixup &fixup: fixups){
 
-    if(regex_match(code, regNewline)) continue;
+    locationCounter = fixup.location;
+    bool more = processStatementSecondPass(*fixup.statement);
 
-    code = regex_replace(code, regComment, "");
-    code = regex_replace(code, regTabs, "");
-    code = regex_replace(code, regEmptySpace, "");
-    
-    if(code.length() == 0) continue;
+    if(errorDetected) {
+      messages<<"Error at line " << fixup.statement->line << "." << endl;
+
+      return false;
+    }
+    if(!more) break;
+  }
+
+  unloadLiteralsPool();
+  return true;
+}
 
+bool Assembler::processStatementFirstPass(const Statement &statement){
 
-    if(regex_search(code, atoms, regLabel)){
+  if(statement.label.length() != 0){
+    processLabelDeclaration(string(statement.label));
+  }
 
-      if(atoms.str(2).length() == 0)
-        continue;
-      code = atoms.str(2); //additional code will be further processed    
+  switch(statement.kind){
+    case LABEL_STATEMENT: break;
+    case GLOBAL_STATEMENT:{
+      for(const Operand &operand: statement.operands)
+        processGlobalDeclaration(string(operand.text));
+      break;
+    }
+    case EXTERN_STATEMENT:{
+      for(const Operand &operand: statement.operands)
+        processExternDeclaration(string(operand.text));
+      break;
     }
-    if(regex_search(code, atoms, regSection)){
-      string label = atoms.str(1);
-      processSectionDeclarationSecondPass(label);
+    case SECTION_STATEMENT:{
+      processSectionDeclaration(string(statement.operands[0].text));
+      break;
     }
-    else if(regex_search(code, atoms, regWord)){
-      string firstSymbol = atoms.str(1);
-      processWordDeclarationSecondPass(firstSymbol);
+    case WORD_STATEMENT:{
+      for(auto i = 0; i < statement.operands.size(); i++)
+        processWordDeclaration();
+      break;
+    }
+    case SKIP_STATEMENT:{
+      processSkipDeclaration(string(statement.operands[0].text));
+      break;
+    }
+    case ASCII_STATEMENT:{
+      processASCIIDeclaration(string(statement.operands[0].text));
+      break;
+    }
+    case EQU_STATEMENT:{
+      processEquDeclaration(string(statement.operands[0].text), statement.expression, statement.line);
+      break;
+    }
+    case END_STATEMENT:{
+      processEndDeclaration();
+      return false;
+    }
+    default:{
+      processInstruction(statement);
+      break;
+    }
+  }
 
-      string additionalSymbols = atoms.str(2);
-      string sym ="";
-      for(auto i = 0; i < additionalSymbols.size();i++ ){
-        if(additionalSymbols[i] == ',' && sym != ""){
-          processWordDeclarationSecondPass(sym);
-          sym ="";
-        }         
-        if(additionalSymbols[i] == ' ') continue;
-        else sym = sym + additionalSymbols[i];  
-      }    
+  // statements other than .skip advance the location counter by a few bytes, so it can't wrap around
+  // before it's caught here
+  if(!errorDetected && currentSection != -1 && locationCounter > MaxSectionSize){
+    errorDetected = true;
+    messages<< "Section "<< SectionTable[currentSection].name<< " exceeds the maximum size." << endl;
+  }
+
+  return true;
+}
+
+bool Assembler::processStatementSecondPass(const Statement &statement){
+
+  switch(statement.kind){
+    case LABEL_STATEMENT: break;
+    case SECTION_STATEMENT:{
+      processSectionDeclarationSecondPass(string(statement.operands[0].text));
+      break;
     }
-    else if(regex_search(code, atoms, regSkip)){
-      string literal = atoms.str(1);
-      processSectionDeclarationSecondPass(literal);    
+    case WORD_STATEMENT:{
+      for(const Operand &operand: statement.operands)
+        processWordDeclarationSecondPass(string(operand.text));
+      break;
     }
-    else if(regex_search(code, atoms, regAscii)){
-      string str = atoms.str(1);
-      processASCIIDeclarationSecondPass(str);    
+    case SKIP_STATEMENT:{
+      processSkipDeclarationSecondPass(string(statement.operands[0].text));
+      break;
     }
-     else if(regex_search(code, atoms, regEqu)){
-      string label = atoms.str(1);
-      string value = atoms.str(2);
-  
-      processEquDeclarationSecondPass(label, value);    
+    case ASCII_STATEMENT:{
+      processASCIIDeclarationSecondPass(string(statement.operands[0].text));
+      break;
     }
-    else if(regex_search(code, atoms, regEnd)){ 
-        
+    case EQU_STATEMENT: break; // evaluated after the first pass
+    case END_STATEMENT:{
       if(currentSection != -1){
         SectionTable[currentSection].length = locationCounter;    
         processSectionEnding();
       }
       locationCounter = 0;
-      break;
-    }
-    else if(regex_search(code, atoms, regGlobal)){ 
-    }
-    else if(regex_search(code, atoms, regExtern)){ 
+      return false;
     }
-    else{
-      processInstructionSecondPass(code);
+    case GLOBAL_STATEMENT: break;
+    case EXTERN_STATEMENT: break;
+    default:{
+      processInstructionSecondPass(statement);
+      break;
     }
-    if(errorDetected) {
-      line++;
-      cout<<"Error at line " << line << "." << endl;
+  }
 
+  return true;
+}
+
+bool Assembler::needsFixup(const Statement &statement){
+
+  switch(statement.kind){
+    // section lengths, symbol values and the end of the file take effect when fixups are resolved
+    case SECTION_STATEMENT: case END_STATEMENT: return true;
+    case WORD_STATEMENT:{
+      for(const Operand &operand: statement.operands)
+        if((operand.text[0] < '0' || operand.text[0] > '9') && operand.text[0] != '-') return true;
       return false;
     }
+    case INSTRUCTION_STATEMENT: break;
+    default: return false;
   }
 
-  unloadLiteralsPool();
-  return true;
+  // operands in the literal pool or with a symbol depend on the final layout of the section
+  switch(statement.mnemonic){
+    case JMP_MNEMONIC: case CALL_MNEMONIC:
+    case BEQ_MNEMONIC: case BNE_MNEMONIC: case BGT_MNEMONIC: return true;
+    case LD_MNEMONIC: return referencesSymbolOrPool(statement.operands[0]);
+    case ST_MNEMONIC: return referencesSymbolOrPool(statement.operands[1]);
+    default: return false;
+  }
+}
+
+bool Assembler::referencesSymbolOrPool(const Operand &operand){
+
+  if(operand.kind == GPR_OPERAND) return false;
+  if(operand.kind != REGISTER_INDIRECT) return true;
+  return operand.offset.length() != 0 && (operand.offset[0] < '0' || operand.offset[0] > '9') && operand.offset[0] != '-';
 }
 
 void Assembler::processGlobalDeclaration(string label){
 
-  for (auto i = 0; i< SymbolTable.size(); i++){
-    if (SymbolTable[i].label == label ){
-      SymbolTable[i].global = true;
-      return;
-    }
+  int32_t i = findSymbol(label);
+  if (i != -1){
+    SymbolTable[i].global = true;
+    return;
   }
 
   SymbolDefinition newSymbol = {label, UndefinedSectionIndex, 0, true, false, false};
   currentSymbolIndex++;
-  SymbolTable.push_back(newSymbol);
+  insertSymbol(newSymbol);
 
 }
 
 void Assembler::processExternDeclaration(string label){
 
-  for (auto i = 0; i< SymbolTable.size(); i++){
-    if (SymbolTable[i].label == label){
-      if(SymbolTable[i].defined == true){
-        errorDetected = true;
-        cout<< "Redefinition of external symbol "<< label <<"."<< endl;
-        return;  
-      }   
-    }
+  int32_t i = findSymbol(label);
+  if (i != -1){
+    if(SymbolTable[i].defined == true){
+      errorDetected = true;
+      messages<< "Redefinition of external symbol "<< label <<"."<< endl;
+      return;  
+    }   
+    // an already declared symbol becomes external instead of being declared twice
+    SymbolTable[i].global = true;
+    SymbolTable[i].external = true;
+    return;
   }  
 
     SymbolDefinition newSymbol = {label, UndefinedSectionIndex, 0, true, true, false};
     currentSymbolIndex++;
-    SymbolTable.push_back(newSymbol);
+    insertSymbol(newSymbol);
 
 }
 
@@ -278,19 +322,18 @@ void Assembler::processSectionDeclaration(string label){
   
   locationCounter = 0;
 
-  for(auto i = 0; i< SymbolTable.size(); i++){
-    if (SymbolTable[i].label == label){
-      currentSection = SymbolTable[i].section;
-      return;
-    }
+  int32_t i = findSymbol(label);
+  if (i != -1){
+    currentSection = SymbolTable[i].section;
+    return;
   }
 
-  SectionDefinition newSection = {label, 0, 0, map<uint32_t,uint8_t>()}; 
+  SectionDefinition newSection = {label, 0, 0, vector<uint8_t>()}; 
   currentSection = SectionTable.size();
   SectionTable.push_back(newSection);
 
   SymbolDefinition newSymbol = {label, (uint32_t)currentSection, 0, false, false, true };
-  SymbolTable.push_back(newSymbol);
+  insertSymbol(newSymbol);
   currentSymbolIndex++;
 }
 
@@ -298,7 +341,7 @@ void Assembler::processWordDeclaration(){
 
   if (currentSection == -1){
     errorDetected = true;
-    cout<< ".word directive can only be used in a section." << endl;
+    messages<< ".word directive can only be used in a section." << endl;
     return;
   }
 
@@ -309,18 +352,31 @@ void Assembler::processSkipDeclaration(string value){
 
   if (currentSection == -1){
     errorDetected = true;
-    cout<< ".skip directive can only be used in a section." << endl;
+    messages<< ".skip directive can only be used in a section." << endl;
     return;
   }
 
-  locationCounter+= getValue(value);
+  if(value[0] == '-'){
+    errorDetected = true;
+    messages<< ".skip directive can not reserve a negative number of bytes." << endl;
+    return;
+  }
+
+  uint64_t end = (uint64_t)locationCounter + (uint32_t)getValue(value);
+  if(end > MaxSectionSize){
+    errorDetected = true;
+    messages<< "Section "<< SectionTable[currentSection].name<< " exceeds the maximum size." << endl;
+    return;
+  }
+
+  locationCounter = end;
 }
 
 void Assembler::processASCIIDeclaration(string str)
 {
   if (currentSection == -1){
     errorDetected = true;
-    cout<< ".string directive can only be used in a section." << endl;
+    messages<< ".string directive can only be used in a section." << endl;
     return;
   }
 
@@ -332,33 +388,35 @@ void Assembler::processASCIIDeclaration(string str)
   if(pad != 4) locationCounter+=pad;
 }
 
-void Assembler::processEquDeclaration(string label, string value){
+void Assembler::processEquDeclaration(string label, const vector<Operand> &expression, uint32_t line){
 
-  int16_t symIndex = -1;
-  for (auto i = 0; i< SymbolTable.size(); i++){
-    if (SymbolTable[i].label == label){
-      symIndex = i;
-      if(SymbolTable[i].external){
-        errorDetected = true;
-        cout<<".equ can not define an external symbol."<<endl;
-        return;
-      }
-      if(SymbolTable[i].defined == true){
-        errorDetected = true;
-        cout<<".equ can only define a previously undefined symbol."<<endl;
-        return;
-      }
-      
-      SymbolTable[i].defined = true;
-      SymbolTable[i].section = AbsoluteSectionIndex; // the symbol is now a constant and therefore
-      // it's in the absolute section    
+  int32_t i = findSymbol(label);
+  if (i != -1){
+    if(SymbolTable[i].external){
+      errorDetected = true;
+      messages<<".equ can not define an external symbol."<<endl;
+      return;
     }
+    if(SymbolTable[i].defined == true){
+      errorDetected = true;
+      messages<<".equ can only define a previously undefined symbol."<<endl;
+      return;
+    }
+    
+    SymbolTable[i].defined = true;
+    SymbolTable[i].section = AbsoluteSectionIndex; // until the expression is evaluated
   }
-  if (symIndex == -1){
+  else{
+    i = SymbolTable.size();
     SymbolDefinition newSymbol = {label, AbsoluteSectionIndex, 0, false, 
       false, true};
-    SymbolTable.push_back(newSymbol);
+    insertSymbol(newSymbol);
   }  
+
+  uint32_t firstNode = expressionNodes.size();
+  int32_t root = buildExpression(expression);
+  equIndex.emplace(i, equDefinitions.size());
+  equDefinitions.push_back({(uint32_t)i, firstNode, root, line});
 }
 
 void Assembler::processEndDeclaration()
@@ -376,234 +434,254 @@ void Assembler::processLabelDeclaration(string label)
 {
   if(currentSection == -1){
     errorDetected = true;
-    cout<< "Labels can only be used in a section." << endl;
+    messages<< "Labels can only be used in a section." << endl;
     return;  
   }
 
-  for (auto i = 0; i< SymbolTable.size(); i++){
-    if(SymbolTable[i].label == label){
-      if(SymbolTable[i].defined || SymbolTable[i].external)
-        {
-          errorDetected = true;
-          cout<<"Redefinition of symbol"<< label <<"."<<endl;
-          return;
-        } 
+  int32_t i = findSymbol(label);
+  if (i != -1){
+    if(SymbolTable[i].defined || SymbolTable[i].external)
+      {
+        errorDetected = true;
+        messages<<"Redefinition of symbol"<< label <<"."<<endl;
+        return;
+      } 
 
-      SymbolTable[i].value = locationCounter;
-      SymbolTable[i].defined = true; 
-      SymbolTable[i].section = currentSection; 
-      return;
-    }
+    SymbolTable[i].value = locationCounter;
+    SymbolTable[i].defined = true; 
+    SymbolTable[i].section = currentSection; 
+    return;
   }
 
     SymbolDefinition newSymbol = {label, (uint32_t)currentSection, (int32_t)locationCounter, false, false, true};
     currentSymbolIndex++;
-    SymbolTable.push_back(newSymbol); 
+    insertSymbol(newSymbol); 
 }
 
-void Assembler::processInstruction(string line){
+void Assembler::processInstruction(const Statement &statement){
 
   if(currentSection == -1){
     errorDetected = true;
-    cout<< "Instructions can only be inside a section." << endl;
+    messages<< "Instructions can only be inside a section." << endl;
     return;
   }
 
-  smatch atoms;
-  if(regex_search(line, atoms, regIret ))
-      locationCounter+=8; // iret uses two instructions
-  
-  else if(regex_search(line, atoms, regLd )){
-    smatch subatoms;
-    smatch subatoms3;
-    string op = atoms.str(1);
-
-    if((regex_search(op, subatoms, regMem ) || regex_search(op, subatoms, regImmed ))
-    && !regex_search(op, subatoms3, regRegInd )){
-      
-      locationCounter+=4; // ld memind uses two instructions, first loads the address, 
-      // then loads the content from the address
-      string symbol = subatoms.str(1);
-      if(regex_search(op, subatoms, regMem ) && !regex_search(op, subatoms, regImmed 
-        )&& !regex_search(op, subatoms, regRegInd)){
-
-        locationCounter+=4;  
-      }
-      
-      int32_t val = 0;
+  if(statement.kind != INSTRUCTION_STATEMENT){
+    locationCounter+=4; // reported as unrecognized in the second pass
+    return;
+  }
 
-      if (symbol[0] >= '0' && symbol[0] <= '9'){
-        
-        val = getValue(symbol);
-        if(symbol[0] =='$') symbol.substr(1, symbol.length()-1); 
-      
-      // check if the literal is already in the pool, if not insert it
-        for(auto j = 0; j < SectionTable[currentSection].literalPool.size(); j++ ){
-          if(symbol == SectionTable[currentSection].literalPool[j].symbol){
-            return;
-          }
-        }
-      
-        SectionTable[currentSection].literalPool.push_back({symbol, val, 4, locationCounter});       
-     }
+  switch(statement.mnemonic){
+    case IRET_MNEMONIC:{
+      locationCounter+=8; // iret uses two instructions
+      break;
     }
-    else{
+    case LD_MNEMONIC:{
+      const Operand &operand = statement.operands[0];
 
       locationCounter+=4;
+      // ld memind uses two instructions, first loads the address, then loads the content from the address
+      if(operand.kind == LITERAL_OPERAND || operand.kind == SYMBOL_OPERAND) locationCounter+=4;
+
+      if(operand.kind == LITERAL_OPERAND || operand.kind == IMMEDIATE_LITERAL) insertLiteral(string(operand.text));
+      break;
     }
-  }
     // jump instruction use absolute address that needs to be inserted into the literal pool
-  else if(regex_search(line, atoms, regBeq)
-      || regex_search(line, atoms, regBne) || regex_search(line, atoms, regBgt)){
-      
+    case BEQ_MNEMONIC: case BNE_MNEMONIC: case BGT_MNEMONIC:
+    case CALL_MNEMONIC: case JMP_MNEMONIC:{
       locationCounter+=4;
-      string op = atoms.str(5);
-      int32_t val = 0;
-     
-      if (op[0] >= '0' && op[0] <= '9'){
-        val = getValue(op);
-      for(auto j = 0; j < SectionTable[currentSection].literalPool.size(); j++ ){
-          if(op == SectionTable[currentSection].literalPool[j].symbol){
-            return;
-          }
-        }
-        
-      SectionTable[currentSection].literalPool.push_back({op, val, 4, locationCounter});
-      }  
+      const Operand &operand = statement.operands.back();
+
+      if(operand.kind == LITERAL_OPERAND) insertLiteral(string(operand.text));
+      break;
     }
-  else if(regex_search(line, atoms, regCall) || regex_search(line, atoms, regJmp)){
-    string op = atoms.str(1);
-    locationCounter+=4;
-    int32_t val = 0;
-    
-    if (op[0] >= '0' && op[0] <= '9'){
-      val = getValue(op);
+    case ST_MNEMONIC:{
+      locationCounter+=4;
+      const Operand &operand = statement.operands[1];
 
-      for(auto j = 0; j < SectionTable[currentSection].literalPool.size(); j++ ){
-        if(op == SectionTable[currentSection].literalPool[j].symbol){
-          return;
-        }
-      }
+      if(operand.kind == LITERAL_OPERAND) insertLiteral(string(operand.text));
+      break;
+    }
+    default:
+      locationCounter+=4;  // instructions are of fixed size of 4 bytes  
+  }
+}
+
+void Assembler::insertLiteral(string literal){
+
+  // negative literals aren't pooled, they are rejected in the second pass
+  if (literal[0] < '0' || literal[0] > '9') return;
+
+  // check if the literal is already in the pool, if not insert it
+  if(SectionTable[currentSection].literalIndex.count(literal)) return;
+
+  insertPoolEntry({literal, getValue(literal), 4, locationCounter});
+}
+
+int32_t Assembler::insertExpressionNode(ExpressionNode node){
+
+  expressionNodes.push_back(node);
+  return expressionNodes.size() - 1;
+}
+
+int32_t Assembler::buildExpression(const vector<Operand> &expression){
+
+  // terms are multiplied and divided first, then added and subtracted, both from left to right
+  int32_t sum = -1;
+  char sumOperation = 0;
+  int32_t product = -1;
 
-      SectionTable[currentSection].literalPool.push_back({op, val, 4, locationCounter});
-    }       
+  for(const Operand &term: expression){
+    int32_t leaf;
+    if(term.kind == LITERAL_OPERAND)
+      leaf = insertExpressionNode({0, string_view(), getValue(string(term.text)), -1, -1});
+    else
+      leaf = insertExpressionNode({0, term.text, 0, -1, -1});
+
+    if(term.operation == '*' || term.operation == '/'){
+      product = insertExpressionNode({term.operation, string_view(), 0, product, leaf});
+      continue;
+    }
+
+    if(product != -1)
+      sum = sum == -1 ? product : insertExpressionNode({sumOperation, string_view(), 0, sum, product});
+    sumOperation = term.operation;
+    product = leaf;
   }
-  else if(regex_search(line, atoms, regSt)){
 
-    locationCounter+=4;
-    smatch subatoms;
-    string op = atoms.str(3);
+  if(sum == -1) return product;
+  return insertExpressionNode({sumOperation, string_view(), 0, sum, product});
+}
 
-    if (regex_search(op, subatoms, regMem)){
-      string symbol = subatoms.str(1);
-      int32_t val = 0;
+bool Assembler::evaluateEquDefinitions(){
 
-      if (symbol[0] >= '0' && symbol[0] <= '9'){
-        val = getValue(symbol);
-        if(symbol[0] =='$') symbol.substr(1, symbol.length()-1); 
-      
-      // check if the literal is already in the pool, if not insert it
-        for(auto j = 0; j < SectionTable[currentSection].literalPool.size(); j++ ){
-          if(symbol == SectionTable[currentSection].literalPool[j].symbol){
-            return;
-          }
-        }
+  // every definition is evaluated once, after the ones it depends on
+  vector<uint8_t> state(equDefinitions.size(), UnvisitedEqu);
+  vector<uint32_t> order;
+  for(auto i = 0; i < equDefinitions.size(); i++){
+    if(!orderEquDefinition(i, state, order)){
+      messages<<"Error at line " << equDefinitions[i].line << "." << endl;
+      return false;
+    }
+  }
+
+  for(uint32_t i: order){
+    const EquDefinition &definition = equDefinitions[i];
+    ExpressionValue result;
 
-        SectionTable[currentSection].literalPool.push_back({symbol, val, 4, locationCounter});       
+    if(!evaluateExpression(definition.root, result)){
+      messages<<"Error at line " << definition.line << "." << endl;
+      return false;
     }
+    // a constant stays in the absolute section, an offset from a label is relocated like a label
+    SymbolTable[definition.symbol].value = result.value;
+    SymbolTable[definition.symbol].section = result.section;
   }
+
+  return true;
 }
-  else
-    locationCounter+=4;  // instructions are of fixed size of 4 bytes  
+
+bool Assembler::orderEquDefinition(uint32_t definition, vector<uint8_t> &state, vector<uint32_t> &order){
+
+  if(state[definition] == OrderedEqu) return true;
+  if(state[definition] == VisitedEqu){
+    errorDetected = true;
+    messages<<"Circular definition of symbol "<< SymbolTable[equDefinitions[definition].symbol].label <<"."<<endl;
+    return false;
+  }
+
+  state[definition] = VisitedEqu;
+
+  // nodes of an expression are consecutive and end with the root
+  for(auto i = equDefinitions[definition].firstNode; i <= equDefinitions[definition].root; i++){
+    if(expressionNodes[i].symbol.empty()) continue;
+
+    int32_t symbol = findSymbol(expressionNodes[i].symbol);
+    if(symbol == -1) continue; // reported when the expression is evaluated
+
+    unordered_map<uint32_t, uint32_t>::iterator dependency = equIndex.find(symbol);
+    if(dependency != equIndex.end() && !orderEquDefinition(dependency->second, state, order)) return false;
+  }
+
+  state[definition] = OrderedEqu;
+  order.push_back(definition);
+  return true;
 }
 
-int32_t Assembler::calculateExpression(string expression){
-  vector<SymbolDefinition> symbols;
-  smatch atoms;
-
-  int32_t res = 0;
-  int32_t op = 0;
-  uint8_t opr = 0; // let 1 be addition, 2 deduction, 3 multplication and 4 division
-
-  if (regex_search(expression, atoms, regExpr)){
-    for (string atom: atoms){
-      if(atom.size() == 0) continue;
-      if(atom[0] == '+') opr = 1;
-      else if(atom[0] == '-') opr = 2;
-      else if(atom[0] == '*') opr = 3;
-      else if(atom[0] == '/') opr = 4;
-      else if(atom[0] >= '0' && atom[0] <= '9') {
-        op = getValue(atom);
-        switch (opr)
-        {
-        case 0:
-          res=op;
-          break;
-        case 1:
-          res+=op;
-          break;
-        case 2:
-          res-=op;
-          break;  
-        case 3:
-          res*=op;
-          break;
-        case 4:
-          res/=op;
-          break;  
-        };
-      }
-      else{
-        int32_t symInd = -1;
-        smatch subatoms;
-        if(regex_match(atom, subatoms, regSym)){
-          for(auto i =0; i< SymbolTable.size(); i++){
-            if (SymbolTable[i].label ==  atom){
-              symInd = i;
-              if(!SymbolTable[i].defined){
-                errorDetected = true;
-                cout<<"Can not use an undefined symbol "<< SymbolTable[i].label <<" in a expression."<<endl;
-                return -1;
-              }
-              if(SymbolTable[i].external){
-                errorDetected = true;
-                cout<<"Can not use an external symbol "<< SymbolTable[i].label <<" in a expression."<<endl;
-                return -1;
-              }
-              op = SymbolTable[i].value;
-              switch (opr)
-        {
-        case 0:
-          res=op;
-          break;
-        case 1:
-          res+=op;
-          break;
-        case 2:
-          res-=op;
-          break;  
-        case 3:
-          res*=op;
-          break;
-        case 4:
-          res/=op;
-          break;  
-        };
-          } 
-          }
-          if (symInd == -1){
-            errorDetected = true;
-            cout<<"Can not use an undeclared symbol "<< atom <<" in a expression."<<endl;
-            return -1;
-          }
-        }
-      }
+bool Assembler::evaluateExpression(int32_t index, ExpressionValue &result){
+
+  const ExpressionNode &node = expressionNodes[index];
+
+  if(node.operation == 0){
+    if(node.symbol.empty()){
+      result = {node.value, AbsoluteSectionIndex};
+      return true;
+    }
+
+    int32_t i = findSymbol(node.symbol);
+    if (i == -1){
+      errorDetected = true;
+      messages<<"Can not use an undeclared symbol "<< node.symbol <<" in a expression."<<endl;
+      return false;
+    }
+    if(SymbolTable[i].external){
+      errorDetected = true;
+      messages<<"Can not use an external symbol "<< SymbolTable[i].label <<" in a expression."<<endl;
+      return false;
     }
+    if(!SymbolTable[i].defined){
+      errorDetected = true;
+      messages<<"Can not use an undefined symbol "<< SymbolTable[i].label <<" in a expression."<<endl;
+      return false;
+    }
+
+    result = {SymbolTable[i].value, (int32_t)SymbolTable[i].section};
+    return true;
   }
 
-  return res;
-}
+  ExpressionValue left, right;
+  if(!evaluateExpression(node.left, left) || !evaluateExpression(node.right, right)) return false;
 
+  bool leftConstant = left.section == AbsoluteSectionIndex;
+  bool rightConstant = right.section == AbsoluteSectionIndex;
+
+  switch (node.operation)
+  {
+  case '+':
+    // an offset can be added to a label, but two labels can't be added
+    if(!leftConstant && !rightConstant) break;
+    result = {(int32_t)((uint32_t)left.value + (uint32_t)right.value), leftConstant ? right.section : left.section};
+    return true;
+  case '-':
+    // the difference of labels from the same section is a constant
+    if(!rightConstant && left.section != right.section) break;
+    result = {(int32_t)((uint32_t)left.value - (uint32_t)right.value),
+      rightConstant ? left.section : (int32_t)AbsoluteSectionIndex};
+    return true;
+  case '*':
+    if(!leftConstant || !rightConstant) break;
+    result = {(int32_t)((uint32_t)left.value * (uint32_t)right.value), AbsoluteSectionIndex};
+    return true;
+  case '/':
+    if(!leftConstant || !rightConstant) break;
+    if(right.value == 0){
+      errorDetected = true;
+      messages<<"Division by zero in a expression."<<endl;
+      return false;
+    }
+    if(left.value == INT32_MIN && right.value == -1){
+      errorDetected = true;
+      messages<<"Division overflows in a expression."<<endl;
+      return false;
+    }
+    result = {left.value / right.value, AbsoluteSectionIndex};
+    return true;
+  }
+
+  errorDetected = true;
+  messages<<"Expression can not be calculated, labels can only be offset or subtracted within a section."<<endl;
+  return false;
+}
 
 void Assembler::processSectionEnding(){
 
@@ -617,10 +695,22 @@ int32_t Assembler::getValue(string literal){
     uint32_t x;
     ss << hex << literal;
     ss >> x;
+    if(ss.fail()){
+      errorDetected = true;
+      messages<<"Literal "<< literal <<" is out of range."<<endl;
+      return 0;
+    }
     return x;
   }
 
-  return stoi(literal);
+  errno = 0;
+  long long x = strtoll(literal.c_str(), nullptr, 10);
+  if(errno == ERANGE || x < INT32_MIN || x > INT32_MAX){
+    errorDetected = true;
+    messages<<"Literal "<< literal <<" is out of range."<<endl;
+    return 0;
+  }
+  return x;
   
 }
 
@@ -653,76 +743,55 @@ void Assembler::processSectionDeclarationSecondPass(string label){
 void Assembler::processWordDeclarationSecondPass(string parameter){
 
   // parameter is a number
-  if(parameter[0] >= '0' && parameter[0] <= '9'){
+  if((parameter[0] >= '0' && parameter[0] <= '9') || parameter[0] == '-'){
 
     int32_t val = getValue(parameter);
-    SectionTable[currentSection].data[locationCounter]= val & 0xff;
-    SectionTable[currentSection].data[locationCounter+1]= (val>>8) & 0xff;
-    SectionTable[currentSection].data[locationCounter+2]= (val>>16) & 0xff;
-    SectionTable[currentSection].data[locationCounter+3]= (val>>24) & 0xff;
+    writeWord(currentSection, locationCounter, val);
     locationCounter+=4;
     return;
   } 
 
   // parameter is a symbol
-  else{
-    currentSymbol = -1;
-    for(auto i = 1; i< SymbolTable.size(); i++){
-      if(SymbolTable[i].label == parameter){
-        currentSymbol = i;
-        break;
-      }
-      if (currentSymbol == -1){
-        cout<< "Symbol not found: "<<parameter<<"."<<endl;
-        errorDetected = true;
-        return;
-      }
-      if(!SymbolTable[currentSymbol].defined){
-        RelocationDefinition newReloc;
-        newReloc.addend = 0;
-        newReloc.type = "R_X86_64_32";
-        newReloc.offset = locationCounter;
-        newReloc.symbolIndex = currentSymbol;
-        SectionTable[currentSection].data[locationCounter]= 0; 
-        SectionTable[currentSection].data[locationCounter+1]= 0; 
-        SectionTable[currentSection].data[locationCounter+2]= 0; 
-        SectionTable[currentSection].data[locationCounter+3]= 0;
-        locationCounter+=4;
-        RelocationTable.push_back(newReloc);
-        
-        return;
-    }
+  currentSymbol = findSymbol(parameter);
+  if (currentSymbol == -1){
+    messages<< "Symbol not found: "<<parameter<<"."<<endl;
+    errorDetected = true;
+    return;
+  }
 
-    SectionTable[currentSection].data[locationCounter]= 0; 
-    SectionTable[currentSection].data[locationCounter+1]= 0; 
-    SectionTable[currentSection].data[locationCounter+2]= 0; 
-    SectionTable[currentSection].data[locationCounter+3]= 0; 
-
-    // symbolic constants have absolute value and therefore relocation is redundant
-    if(SymbolTable[currentSymbol].section != AbsoluteSectionIndex){   
-      RelocationDefinition newReloc;
-      newReloc.addend = 0;
-      newReloc.type = "R_X86_64_32";
-      newReloc.offset = locationCounter;
-      newReloc.symbolIndex = currentSymbol;
-      if(SymbolTable[currentSymbol].global == false) {//locally symbols are not visible to linker
-        newReloc.addend = SymbolTable[currentSymbol].value;
-      }
-    
-      RelocationTable.push_back(newReloc);
+  writeWord(currentSection, locationCounter, 0);
 
-      SectionTable[currentSection].data[locationCounter]= 0; 
-      SectionTable[currentSection].data[locationCounter+1]= 0;  
-      SectionTable[currentSection].data[locationCounter+2]= 0;  
-      SectionTable[currentSection].data[locationCounter+3]= 0; 
-    }
+  if(!SymbolTable[currentSymbol].defined){
+    RelocationDefinition newReloc;
+    newReloc.addend = 0;
+    newReloc.type = "R_X86_64_32";
+    newReloc.offset = locationCounter;
+    newReloc.symbolIndex = currentSymbol;
+    newReloc.section = currentSection;
+    locationCounter+=4;
+    insertRelocation(newReloc);
+    
+    return;
+  }
 
-    SectionTable[currentSection].data[locationCounter]= SymbolTable[currentSymbol].value & 0xff; 
-    SectionTable[currentSection].data[locationCounter+1]= (SymbolTable[currentSymbol].value>>8) & 0xff;  
-    SectionTable[currentSection].data[locationCounter+2]= (SymbolTable[currentSymbol].value>>16) & 0xff;  
-    SectionTable[currentSection].data[locationCounter+3]= (SymbolTable[currentSymbol].value>>24) & 0xff; 
+  // symbolic constants have absolute value and therefore relocation is redundant
+  if(SymbolTable[currentSymbol].section != AbsoluteSectionIndex){   
+    RelocationDefinition newReloc;
+    newReloc.addend = 0;
+    newReloc.type = "R_X86_64_32";
+    newReloc.offset = locationCounter;
+    newReloc.symbolIndex = currentSymbol;
+    newReloc.section = currentSection;
+    if(SymbolTable[currentSymbol].global == false) {//locally symbols are not visible to linker
+      int32_t sectionSymbol = findSymbol(SectionTable[SymbolTable[currentSymbol].section].name);
+      if (sectionSymbol != -1) newReloc.symbolIndex = sectionSymbol;
+      newReloc.addend = SymbolTable[currentSymbol].value;
     }
+  
+    insertRelocation(newReloc);
   }
+
+  writeWord(currentSection, locationCounter, SymbolTable[currentSymbol].value);
   
   locationCounter+= 4;
 }
@@ -731,9 +800,7 @@ void Assembler::processSkipDeclarationSecondPass(string literal){
 
   uint32_t bytes = getValue(literal);
 
-  for(auto i = 0; i< bytes; i++){
-    SectionTable[currentSection].data[locationCounter+i]= 0; 
-  }
+  reserveData(currentSection, locationCounter + bytes);
 
   locationCounter+=bytes;
 }
@@ -742,8 +809,8 @@ void Assembler::processASCIIDeclarationSecondPass(string str){
   
   uint8_t stringSize = str.length();
   
-  for(auto j = 1; j<stringSize-1; j++)
-    SectionTable[currentSection].data[locationCounter+j - 1]= (uint8_t)str[j]; 
+  // without the quotes
+  writeData(currentSection, locationCounter, (const uint8_t *)str.data() + 1, stringSize - 2);
   
   locationCounter+=stringSize - 2;
 
@@ -752,19 +819,29 @@ void Assembler::processASCIIDeclarationSecondPass(string str){
 
 }
 
-void Assembler::processInstructionSecondPass(string line){
+void Assembler::processInstructionSecondPass(const Statement &statement){
   
-  smatch atoms;
+  if(statement.kind != INSTRUCTION_STATEMENT){
+    messages<< "Unrecognized command."<<endl;
+
+    errorDetected = true;
+    return;
+  }
+
+  const vector<Operand> &operands = statement.operands;
   uint8_t instructionBytes[4] ={ 0x0, 0x0, 0x0, 0x0};
   // b[0]|b[1]|b[2]|b[3]
+  switch(statement.mnemonic){
   //no operand instructions
-  if(regex_search(line, atoms, regHalt)){
+  case HALT_MNEMONIC:{
     instructionBytes[0] = 0x00;
+    break;
   }
-  else if(regex_search(line, atoms, regInt)){
+  case INT_MNEMONIC:{
     instructionBytes[0] = 0x10;
+    break;
   }
-  else if(regex_search(line, atoms, regRet)){
+  case RET_MNEMONIC:{
     //pop PC
     instructionBytes[0] = 0x93;
     int8_t d = 0x04; 
@@ -777,8 +854,9 @@ void Assembler::processInstructionSecondPass(string line){
 
     instructionBytes[3] = (d  & 0x00f0) >> 4;
     instructionBytes[3] |= d & 0x000f;
+    break;
   }
-  else if(regex_search(line, atoms, regIret)){
+  case IRET_MNEMONIC:{
     //consists of two instructions
 
     // popPC
@@ -795,10 +873,7 @@ void Assembler::processInstructionSecondPass(string line){
     instructionBytes[3] |= d & 0x000f;
 
      
-    SectionTable[currentSection].data[locationCounter]= instructionBytes[0]; 
-    SectionTable[currentSection].data[locationCounter+1]= instructionBytes[1]; 
-    SectionTable[currentSection].data[locationCounter+2]= instructionBytes[2]; 
-    SectionTable[currentSection].data[locationCounter+3]= instructionBytes[3];
+    writeData(currentSection, locationCounter, instructionBytes, 4);
     
     locationCounter+=4;
 
@@ -821,11 +896,12 @@ void Assembler::processInstructionSecondPass(string line){
 
     instructionBytes[3] = (d  & 0x00f0) >> 4;
     instructionBytes[3] |= d & 0x000f;
+    break;
   }
   //single operand isntructions
-  else if(regex_search(line, atoms, regPop)){
+  case POP_MNEMONIC:{
     instructionBytes[0] = 0x93;
-    uint8_t reg = fetchRegister(atoms.str(1));
+    uint8_t reg = fetchRegister(string(operands[0].text));
     int8_t d = 0x04; 
 
     instructionBytes[1] = reg<<4;
@@ -836,21 +912,11 @@ void Assembler::processInstructionSecondPass(string line){
 
     instructionBytes[3] = (d  & 0x00f0) >> 4;
     instructionBytes[3] |= d & 0x000f;
-
+    break;
   }
-  else if(regex_search(line, atoms, regPush)){
+  case PUSH_MNEMONIC:{
     instructionBytes[0] = 0x81;
-    string regS = atoms.str(1);
-    uint8_t reg;
-    if(regS == "%sp"){
-      reg = 14;
-    }
-    else if(regS == "%pc"){
-      reg = 15;
-    }
-    else{
-      reg = getValue(regS.substr(2, regS.length()-2));
-    }
+    uint8_t reg = fetchRegister(string(operands[0].text));
     
     int16_t d = 0xfffc; // -4
 
@@ -862,75 +928,86 @@ void Assembler::processInstructionSecondPass(string line){
 
     instructionBytes[3] = d & 0x00f0;
     instructionBytes[3] |= d & 0x000f;
-
+    break;
   }
-  else if(regex_search(line, atoms, regNot)){
+  case NOT_MNEMONIC:{
     instructionBytes[0] = 0x60;
-    instructionBytes[1] = fetchRegister(atoms.str(1))<<4;
+    instructionBytes[1] = fetchRegister(string(operands[0].text))<<4;
+    break;
   }
   // arithmetic, logic, shift and swap operations
-  else if(regex_search(line, atoms, regAdd)){
+  case ADD_MNEMONIC:{
     instructionBytes[0] = 0x50;
-    instructionBytes[1] = fetchRegister(atoms.str(3))<<4;
-    instructionBytes[1] |= fetchRegister(atoms.str(3));
-    instructionBytes[2] = fetchRegister(atoms.str(1))<<4;
+    instructionBytes[1] = fetchRegister(string(operands[1].text))<<4;
+    instructionBytes[1] |= fetchRegister(string(operands[1].text));
+    instructionBytes[2] = fetchRegister(string(operands[0].text))<<4;
+    break;
   }
-  else if(regex_search(line, atoms, regSub)){
+  case SUB_MNEMONIC:{
     instructionBytes[0] = 0x51;
-    instructionBytes[1] = fetchRegister(atoms.str(3))<<4;
-    instructionBytes[1] |= fetchRegister(atoms.str(3));
-    instructionBytes[2] = fetchRegister(atoms.str(1))<<4;
+    instructionBytes[1] = fetchRegister(string(operands[1].text))<<4;
+    instructionBytes[1] |= fetchRegister(string(operands[1].text));
+    instructionBytes[2] = fetchRegister(string(operands[0].text))<<4;
+    break;
   }
-  else if(regex_search(line, atoms, regMul)){
+  case MUL_MNEMONIC:{
     instructionBytes[0] = 0x52;
-    instructionBytes[1] = fetchRegister(atoms.str(3))<<4;
-    instructionBytes[1] |= fetchRegister(atoms.str(3));
-    instructionBytes[2] = fetchRegister(atoms.str(1))<<4;
+    instructionBytes[1] = fetchRegister(string(operands[1].text))<<4;
+    instructionBytes[1] |= fetchRegister(string(operands[1].text));
+    instructionBytes[2] = fetchRegister(string(operands[0].text))<<4;
+    break;
   }
-  else if(regex_search(line, atoms, regDiv)){
+  case DIV_MNEMONIC:{
     instructionBytes[0] = 0x53;
-    instructionBytes[1] = fetchRegister(atoms.str(3))<<4;
-    instructionBytes[1] |= fetchRegister(atoms.str(3));
-    instructionBytes[2] = fetchRegister(atoms.str(1))<<4;
+    instructionBytes[1] = fetchRegister(string(operands[1].text))<<4;
+    instructionBytes[1] |= fetchRegister(string(operands[1].text));
+    instructionBytes[2] = fetchRegister(string(operands[0].text))<<4;
+    break;
   }
-  else if(regex_search(line, atoms, regAnd)){
+  case AND_MNEMONIC:{
     instructionBytes[0] = 0x61;
-    instructionBytes[1] = fetchRegister(atoms.str(3))<<4;
-    instructionBytes[1] |= fetchRegister(atoms.str(3));
-    instructionBytes[2] = fetchRegister(atoms.str(1))<<4;
+    instructionBytes[1] = fetchRegister(string(operands[1].text))<<4;
+    instructionBytes[1] |= fetchRegister(string(operands[1].text));
+    instructionBytes[2] = fetchRegister(string(operands[0].text))<<4;
+    break;
   }
-  else if(regex_search(line, atoms, regOr)){
+  case OR_MNEMONIC:{
     instructionBytes[0] = 0x62;
-    instructionBytes[1] = fetchRegister(atoms.str(3))<<4;
-    instructionBytes[1] |= fetchRegister(atoms.str(1));
-    instructionBytes[2] = fetchRegister(atoms.str(3))<<4;
+    instructionBytes[1] = fetchRegister(string(operands[1].text))<<4;
+    instructionBytes[1] |= fetchRegister(string(operands[0].text));
+    instructionBytes[2] = fetchRegister(string(operands[1].text))<<4;
+    break;
   }
-  else if(regex_search(line, atoms, regXor)){
+  case XOR_MNEMONIC:{
     instructionBytes[0] = 0x63;
-    instructionBytes[1] = fetchRegister(atoms.str(3))<<4;
-    instructionBytes[1] |= fetchRegister(atoms.str(1));
-    instructionBytes[2] = fetchRegister(atoms.str(3))<<4;
+    instructionBytes[1] = fetchRegister(string(operands[1].text))<<4;
+    instructionBytes[1] |= fetchRegister(string(operands[0].text));
+    instructionBytes[2] = fetchRegister(string(operands[1].text))<<4;
+    break;
   }
-  else if(regex_search(line, atoms, regShl)){
+  case SHL_MNEMONIC:{
     instructionBytes[0] = 0x70;
-    instructionBytes[1] = fetchRegister(atoms.str(3))<<4;
-    instructionBytes[1] |= fetchRegister(atoms.str(1));
-    instructionBytes[2] = fetchRegister(atoms.str(3))<<4;
+    instructionBytes[1] = fetchRegister(string(operands[1].text))<<4;
+    instructionBytes[1] |= fetchRegister(string(operands[0].text));
+    instructionBytes[2] = fetchRegister(string(operands[1].text))<<4;
+    break;
   }
-  else if(regex_search(line, atoms, regShr)){
+  case SHR_MNEMONIC:{
     instructionBytes[0] = 0x71;
-    instructionBytes[1] = fetchRegister(atoms.str(3))<<4;
-    instructionBytes[1] |= fetchRegister(atoms.str(1));
-    instructionBytes[2] = fetchRegister(atoms.str(3))<<4;
+    instructionBytes[1] = fetchRegister(string(operands[1].text))<<4;
+    instructionBytes[1] |= fetchRegister(string(operands[0].text));
+    instructionBytes[2] = fetchRegister(string(operands[1].text))<<4;
+    break;
   }
-  else if(regex_search(line, atoms, regXchg)){
+  case XCHG_MNEMONIC:{
     instructionBytes[0] = 0x40;
-    instructionBytes[1] = fetchRegister(atoms.str(1));
-    instructionBytes[2] = fetchRegister(atoms.str(3))<<4;
+    instructionBytes[1] = fetchRegister(string(operands[0].text));
+    instructionBytes[2] = fetchRegister(string(operands[1].text))<<4;
+    break;
   }
   //jump instructions
-  else if(regex_search(line, atoms, regJmp)){
-    string jumpAddr = atoms.str(1);
+  case JMP_MNEMONIC:{
+    string jumpAddr = string(operands[0].text);
     int16_t d = setAbsoluteJump(jumpAddr);
 
     instructionBytes[0] = 0x38;
@@ -943,9 +1020,10 @@ void Assembler::processInstructionSecondPass(string line){
 
     instructionBytes[3] = (d  & 0x00f0);
     instructionBytes[3] |= d & 0x000f;
+    break;
   }
-  else if(regex_search(line, atoms, regCall)){
-    string jumpAddr = atoms.str(1);
+  case CALL_MNEMONIC:{
+    string jumpAddr = string(operands[0].text);
     int16_t d = setAbsoluteJump(jumpAddr);
     instructionBytes[0] = 0x21;
 
@@ -957,12 +1035,13 @@ void Assembler::processInstructionSecondPass(string line){
 
     instructionBytes[3] = (d  & 0x00f0);
     instructionBytes[3] |= d & 0x000f;
+    break;
   }
-  else if(regex_search(line, atoms, regBeq)){
-    string jumpAddr = atoms.str(5);
+  case BEQ_MNEMONIC:{
+    string jumpAddr = string(operands[2].text);
   
-    uint8_t reg1 = fetchRegister(atoms.str(1));
-    uint8_t reg2 = fetchRegister(atoms.str(3));
+    uint8_t reg1 = fetchRegister(string(operands[0].text));
+    uint8_t reg2 = fetchRegister(string(operands[1].text));
     int16_t d = setAbsoluteJump(jumpAddr);
     
     instructionBytes[0] = 0x39;
@@ -975,11 +1054,12 @@ void Assembler::processInstructionSecondPass(string line){
 
     instructionBytes[3] = (d  & 0x00f0);
     instructionBytes[3] |= d & 0x000f; 
+    break;
   }
-  else if(regex_search(line, atoms, regBne)){
-    string jumpAddr = atoms.str(5);
-    uint8_t reg1 = fetchRegister(atoms.str(1));
-    uint8_t reg2 = fetchRegister(atoms.str(3));
+  case BNE_MNEMONIC:{
+    string jumpAddr = string(operands[2].text);
+    uint8_t reg1 = fetchRegister(string(operands[0].text));
+    uint8_t reg2 = fetchRegister(string(operands[1].text));
     int16_t d = setAbsoluteJump(jumpAddr);
 
     instructionBytes[0] = 0x3a;
@@ -992,11 +1072,12 @@ void Assembler::processInstructionSecondPass(string line){
 
     instructionBytes[3] = (d  & 0x00f0);
     instructionBytes[3] |= d & 0x000f; 
+    break;
   }
-  else if(regex_search(line, atoms, regBgt)){
-    string jumpAddr = atoms.str(5);
-    uint8_t reg1 = fetchRegister(atoms.str(1));
-    uint8_t reg2 = fetchRegister(atoms.str(3));
+  case BGT_MNEMONIC:{
+    string jumpAddr = string(operands[2].text);
+    uint8_t reg1 = fetchRegister(string(operands[0].text));
+    uint8_t reg2 = fetchRegister(string(operands[1].text));
     int16_t d = setAbsoluteJump(jumpAddr);
     
     instructionBytes[0] = 0x3b;
@@ -1006,10 +1087,11 @@ void Assembler::processInstructionSecondPass(string line){
 
     instructionBytes[3] = (d  & 0x00f0);
     instructionBytes[3] |= d & 0x000f;  
+    break;
   }
-  else if(regex_search(line, atoms, regCsrrd)){
-    uint8_t reg = fetchRegister(atoms.str(3));
-    char csrIndicator = atoms.str(1)[1];
+  case CSRRD_MNEMONIC:{
+    uint8_t reg = fetchRegister(string(operands[1].text));
+    char csrIndicator = operands[0].text[1];
     uint8_t csr = 0;
 
     switch(csrIndicator){
@@ -1022,11 +1104,12 @@ void Assembler::processInstructionSecondPass(string line){
 
     instructionBytes[1] = reg <<4;
     instructionBytes[1] |= csr;
+    break;
   }
-  else if(regex_search(line, atoms, regCsrwr)){
+  case CSRWR_MNEMONIC:{
     
-    uint8_t reg = fetchRegister(atoms.str(1));
-    char csrIndicator = atoms.str(3)[1];
+    uint8_t reg = fetchRegister(string(operands[0].text));
+    char csrIndicator = operands[1].text[1];
     uint8_t csr = 0;
 
     switch(csrIndicator){
@@ -1039,50 +1122,40 @@ void Assembler::processInstructionSecondPass(string line){
 
     instructionBytes[1] = csr << 4;
     instructionBytes[1] |= reg;
+    break;
   }
-  else if(regex_search(line, atoms, regLd)){ 
-    string op1 = atoms.str(1);
-    string regS = atoms.str(atoms.size()-1);
-    uint8_t dest;
+  case LD_MNEMONIC:{ 
+    const Operand &op1 = operands[0];
+    uint8_t dest = fetchRegister(string(operands[1].text));
 
-    if(regS == "sp"){
-      dest = 14;
-    }
-    else if(regS == "pc"){
-      dest = 15;
-    }
-    else{
-      dest = getValue(regS.substr(1, regS.length()-1));
-    }
-
-    smatch subatoms;
-    if(regex_search(op1, subatoms, regRegInd)){
-      string subOp1 = subatoms.str(1);
-      uint8_t src = fetchRegister(subatoms.str(1));
-      string subOp2 = subatoms.str(5);
-      int32_t value;
+    if(op1.kind == REGISTER_INDIRECT){
+      uint8_t src = fetchRegister(string(op1.text));
+      string subOp2 = string(op1.offset);
+      int32_t value = 0;
 
       if(subOp2.size() == 0){
         value = 0x0;
       }
-      else if(subOp2[0]>='0' && subOp2[0]<= '9'){
+      else if((subOp2[0]>='0' && subOp2[0]<= '9') || subOp2[0] == '-'){
         value = getValue(subOp2);  
       }
       else {
-        for(auto i= 0; i< SymbolTable.size(); i++){
-          if(SymbolTable[i].label == subOp2){
-            if(SymbolTable[i].section != AbsoluteSectionIndex){
-              errorDetected = true;
-              cout << "Value of a loaded symbol must be determined."<< endl;
-              return;
-            }          
-            value = SymbolTable[i].value;
-          }
+        int32_t i = findSymbol(subOp2);
+        if(i == -1){
+          errorDetected = true;
+          messages << "Symbol not found: "<< subOp2 << "."<< endl;
+          return;
         }
+        if(SymbolTable[i].section != AbsoluteSectionIndex){
+          errorDetected = true;
+          messages << "Value of a loaded symbol must be determined."<< endl;
+          return;
+        }          
+        value = SymbolTable[i].value;
       }
       if((value & 0xf000) != 0){
         errorDetected = true;
-        cout << "Loaded value out of bounds."<< endl;
+        messages << "Loaded value out of bounds."<< endl;
         return;
       }
 
@@ -1098,23 +1171,11 @@ void Assembler::processInstructionSecondPass(string line){
       instructionBytes[3] |= value & 0x000f;
     }
     // loads immediate value
-    else if(regex_search(op1, subatoms, regImmed)){
-      string op = subatoms.str(1);
-      int32_t value;
+    else if(op1.kind == IMMEDIATE_LITERAL || op1.kind == IMMEDIATE_SYMBOL){
+      string op = string(op1.text);
       int32_t symIndex = -1; 
       
-      if(op[0]>='0' && op[0]<= '9'){
-        value = getValue(op);
-      }
-      else {
-        for(auto i= 0; i< SymbolTable.size(); i++){
-          if(SymbolTable[i].label == op){
-            value = SymbolTable[i].value;
-            symIndex = i;
-            break;
-          }
-        }
-      }
+      if(op1.kind == IMMEDIATE_SYMBOL) symIndex = findSymbol(op);
 
       int32_t displacement = 0;
       displacement =  findSymbolLocationInLiteralPool(op) - locationCounter - 4;
@@ -1137,24 +1198,12 @@ void Assembler::processInstructionSecondPass(string line){
       instructionBytes[3] |= displacement & 0x000f; 
     }
     // in order to load from address, mentioned address must first be loaded into a register
-    else if(regex_search(op1, subatoms, regMem)){
+    else if(op1.kind == LITERAL_OPERAND || op1.kind == SYMBOL_OPERAND){
       //therefore, this consists of immediate and then register indirect load 
-      string op = subatoms.str(1);
-      uint32_t value;
+      string op = string(op1.text);
       int32_t symIndex = -1;
 
-      if(op[0]>='0' && op[0]<= '9'){
-        value = getValue(op);
-      }
-      else {
-        for(auto i= 0; i< SymbolTable.size(); i++){
-          if(SymbolTable[i].label == op){
-            value = SymbolTable[i].value;
-            symIndex = i;
-            break;
-          }
-        }
-      }
+      if(op1.kind == SYMBOL_OPERAND) symIndex = findSymbol(op);
 
       int32_t displacement;
       displacement = findSymbolLocationInLiteralPool(op) - locationCounter - 4;
@@ -1175,12 +1224,7 @@ void Assembler::processInstructionSecondPass(string line){
       instructionBytes[3] = displacement  & 0x00f0;
       instructionBytes[3] |= displacement & 0x000f; 
 
-      stringstream ss;
-      ss<<hex<<+instructionBytes[0]<<+instructionBytes[1]<<+instructionBytes[2]<<+instructionBytes[3];
-      SectionTable[currentSection].data[locationCounter]= instructionBytes[0]; 
-      SectionTable[currentSection].data[locationCounter+1]= instructionBytes[1]; 
-      SectionTable[currentSection].data[locationCounter+2]= instructionBytes[2]; 
-      SectionTable[currentSection].data[locationCounter+3]= instructionBytes[3];
+      writeData(currentSection, locationCounter, instructionBytes, 4);
     
       locationCounter+=4;
 
@@ -1202,7 +1246,7 @@ void Assembler::processInstructionSecondPass(string line){
     else{
       instructionBytes[0] = 0x91;
 
-      uint8_t src = getValue(op1.substr(1, op1.size()-1));
+      uint8_t src = fetchRegister(string(op1.text));
 
       instructionBytes[1] = dest <<4;
       instructionBytes[1] |= src;
@@ -1210,44 +1254,43 @@ void Assembler::processInstructionSecondPass(string line){
       instructionBytes[2] = 0x0 << 4;
       instructionBytes[2] |= 0x0;
     }
-
+    break;
   }
   // store
-  else if (regex_search(line, atoms, regSt)){
-    string op1 = atoms.str(1);
-    string op2 = atoms.str(3);
-    uint8_t src = getValue(op1.substr(2, op1.size() - 2));
+  case ST_MNEMONIC:{
+    const Operand &op2 = operands[1];
+    uint8_t src = fetchRegister(string(operands[0].text));
 
-    smatch subatoms;
     // register indirect
-    if (regex_search(op2, subatoms, regRegInd)){   
-      string subOp1 = subatoms.str(1);   
-      uint8_t dest = getValue(subOp1.substr(2, subOp1.length() - 1));
-      string subOp2 = subatoms.str(3);      
-      int32_t value;
+    if (op2.kind == REGISTER_INDIRECT){   
+      uint8_t dest = fetchRegister(string(op2.text));
+      string subOp2 = string(op2.offset);      
+      int32_t value = 0;
 
       if (subOp2.length() == 0){
         value = 0x0;
       }
-      else if (subOp2[0] >= '0' && subOp2[0] <= '9'){
+      else if ((subOp2[0] >= '0' && subOp2[0] <= '9') || subOp2[0] == '-'){
         value = getValue(subOp2);
       }
       else{
-        for (auto i = 0; i < SymbolTable.size(); i++){
-          if (SymbolTable[i].label == subOp2){
-            if (SymbolTable[i].section != AbsoluteSectionIndex){
-              errorDetected = true;
-              cout << "Value of a loaded symbol must be determined." << endl;
-              return;
-            }
-            value = SymbolTable[i].value;
-          }
+        int32_t i = findSymbol(subOp2);
+        if (i == -1){
+          errorDetected = true;
+          messages << "Symbol not found: " << subOp2 << "." << endl;
+          return;
         }
+        if (SymbolTable[i].section != AbsoluteSectionIndex){
+          errorDetected = true;
+          messages << "Value of a loaded symbol must be determined." << endl;
+          return;
+        }
+        value = SymbolTable[i].value;
       }
-      if ((value & 0x0fff) != 0)
+      if ((value & 0xf000) != 0)
       {
         errorDetected = true;
-        cout << "Loaded value out of bounds." << endl;
+        messages << "Loaded value out of bounds." << endl;
         return;
       }
 
@@ -1262,23 +1305,11 @@ void Assembler::processInstructionSecondPass(string line){
       instructionBytes[3] = (value & 0x00f0) >> 4;
       instructionBytes[3] |= value & 0x000f;
     }
-    else if (regex_search(op2, subatoms, regMem)){
-      string op = subatoms.str(1);
-      uint32_t value;
+    else{
+      string op = string(op2.text);
       int32_t symIndex = -1;
 
-      if (op[0] >= '0' && op[0] <= '9'){
-        value = getValue(op);
-      }
-      else{
-        for (auto i = 0; i < SymbolTable.size(); i++){
-          if (SymbolTable[i].label == op){
-            value = SymbolTable[i].value;
-            symIndex = i;
-            break;
-          }
-        }
-      }
+      if (op2.kind == SYMBOL_OPERAND) symIndex = findSymbol(op);
 
       uint16_t displacement = findSymbolLocationInLiteralPool(op) - locationCounter - 4;
       
@@ -1299,73 +1330,42 @@ void Assembler::processInstructionSecondPass(string line){
       instructionBytes[3] = displacement & 0x00f0;
       instructionBytes[3] |= displacement & 0x000f;
     }
+    break;
   }
-  else{
-    cout<< "Unrecognized command."<<endl;
-
-    errorDetected = true;
-    return;
   }
 
-  stringstream ss;
-  ss<<hex<<+instructionBytes[0]<<+instructionBytes[1]<<+instructionBytes[2]<<+instructionBytes[3];
-
-  SectionTable[currentSection].data[locationCounter]= instructionBytes[0]; 
-  SectionTable[currentSection].data[locationCounter+1]= instructionBytes[1]; 
-  SectionTable[currentSection].data[locationCounter+2]= instructionBytes[2]; 
-  SectionTable[currentSection].data[locationCounter+3]= instructionBytes[3];
+  writeData(currentSection, locationCounter, instructionBytes, 4);
   locationCounter+=4;
 
 }
 
-void Assembler::processEquDeclarationSecondPass(string label, string value){
-
-   for (auto i = 0; i< SymbolTable.size(); i++){
-    if (SymbolTable[i].label == label){
-      SymbolTable[i].value = calculateExpression(value);
-      break;  
-    }
-  }
-}
-
 int32_t Assembler::setAbsoluteJump(string addr){
   
   int32_t displacement = findSymbolLocationInLiteralPool(addr) - locationCounter - 4;
   
-  int32_t currSym = -1;
-  for(auto i =0; i< SymbolTable.size(); i++){
-    if (SymbolTable[i].label == addr) currSym = i;
-  }
+  int32_t currSym = findSymbol(addr);
   // if address of the jump happens to be a symbol, this calls for a Relocation Tbale entry
   if(currSym != -1){
     // and symbol is not from the Absolute Section
     if(SymbolTable[currSym].section != AbsoluteSectionIndex){   
-        for(auto i = 0; i< RelocationTable.size(); i++){
-          if((currSym == RelocationTable[i].symbolIndex && RelocationTable[i].section == currentSection)
-            || (SymbolTable[currSym].section == currentSection 
-            && SymbolTable[currSym].value == RelocationTable[i].addend))
-            
-            return displacement;
-        }
+        uint32_t entry = displacement + locationCounter + 4;
+        if(SectionTable[currentSection].relocationIndex.count(entry)) return displacement;
+
         RelocationDefinition newReloc;
         newReloc.addend = 0;
         newReloc.type = "R_X86_64_32";
-        newReloc.offset = findSymbolLocationInLiteralPool(addr);
+        newReloc.offset = entry;
         newReloc.symbolIndex = currSym;
         newReloc.section = currentSection;
 
         if(SymbolTable[currSym].global == false){ //locally symbols are not visible to linker
-          string symName = SectionTable[SymbolTable[currSym].section].name;
-          for (auto i = 0; i< SymbolTable.size(); i++)
-              if (SymbolTable[i].label == symName){
-                newReloc.symbolIndex = i;
-                break;
-              }
+          int32_t sectionSymbol = findSymbol(SectionTable[SymbolTable[currSym].section].name);
+          if (sectionSymbol != -1) newReloc.symbolIndex = sectionSymbol;
 
               newReloc.addend = SymbolTable[currSym].value;
       }  
 
-        RelocationTable.push_back(newReloc);
+        insertRelocation(newReloc);
     }
          
   }   
@@ -1375,34 +1375,82 @@ int32_t Assembler::setAbsoluteJump(string addr){
 
 uint32_t Assembler::findSymbolLocationInLiteralPool(string symbol){
 
-  for(auto i = 0; i< SectionTable[currentSection].literalPool.size(); i++){
-    if (SectionTable[currentSection].literalPool[i].symbol == symbol){ 
-      return SectionTable[currentSection].literalPool[i].location;
-    }
+  unordered_map<string, uint32_t>::iterator entry = SectionTable[currentSection].literalIndex.find(symbol);
+  if(entry != SectionTable[currentSection].literalIndex.end()){
+    return SectionTable[currentSection].literalPool[entry->second].location;
   }
-  for(auto i = 0; i <SymbolTable.size(); i++){
-    if(SymbolTable[i].label == symbol){
-      int32_t val = 0;
-      if (SymbolTable[i].section == AbsoluteSectionIndex) val = SymbolTable[i].value;
-      uint32_t newLoc = SectionTable[currentSection].literalPool.size()*4 + SectionTable[currentSection].length;
-      SectionTable[currentSection].literalPool.push_back({symbol, val, 4, newLoc});
-      return newLoc;
-    }
+  int32_t i = findSymbol(symbol);
+  if(i != -1){
+    int32_t val = 0;
+    if (SymbolTable[i].section == AbsoluteSectionIndex) val = SymbolTable[i].value;
+    uint32_t newLoc = SectionTable[currentSection].literalPool.size()*4 + SectionTable[currentSection].length;
+    insertPoolEntry({symbol, val, 4, newLoc});
+    return newLoc;
   }
-  cout<<"Jump address symbol "<< symbol<<" undeclared."<<endl;
+  messages<<"Jump address symbol "<< symbol<<" undeclared."<<endl;
   errorDetected = true;
  
   return 0;
 }
 
-void Assembler::generateRelocation(uint32_t symbolIndex , uint32_t entry, uint16_t sectionIndex){
+int32_t Assembler::findSymbol(string_view label){
 
-  for(auto i =0; i< RelocationTable.size(); i++){
-    if (RelocationTable[i].symbolIndex == symbolIndex && 
-        RelocationTable[i].section == sectionIndex ) 
-          return;
+  unordered_map<string_view, uint32_t>::iterator symbol = symbolIndex.find(label);
+  if(symbol == symbolIndex.end()) return -1;
+  return symbol->second;
+}
+
+void Assembler::insertSymbol(SymbolDefinition symbol){
+
+  // labels are interned, the index keys stay valid while the table grows
+  string_view label = *symbolLabels.insert(symbol.label).first;
+  symbolIndex.emplace(label, SymbolTable.size());
+  SymbolTable.push_back(symbol);
+}
+
+void Assembler::writeData(uint32_t section, uint32_t location, const uint8_t *bytes, uint32_t size){
+
+  if(location > UINT32_MAX - size){
+    errorDetected = true;
+    messages<< "Data at "<< hex<< location<< dec<< " runs past the end of section "<< SectionTable[section].name<< "."<< endl;
+    return;
   }
 
+  reserveData(section, location + size);
+  memcpy(SectionTable[section].data.data() + location, bytes, size);
+}
+
+void Assembler::writeWord(uint32_t section, uint32_t location, uint32_t value){
+
+  uint8_t bytes[4] = {(uint8_t)(value & 0xff), (uint8_t)((value>>8) & 0xff),
+    (uint8_t)((value>>16) & 0xff), (uint8_t)((value>>24) & 0xff)};
+  writeData(section, location, bytes, 4);
+}
+
+void Assembler::reserveData(uint32_t section, uint32_t end){
+
+  // resize grows the capacity geometrically, so emitting byte by byte stays linear
+  if(SectionTable[section].data.size() < end) SectionTable[section].data.resize(end, 0);
+}
+
+void Assembler::insertPoolEntry(LiteralsTable entry){
+
+  SectionTable[currentSection].literalIndex.emplace(entry.symbol, SectionTable[currentSection].literalPool.size());
+  SectionTable[currentSection].literalPool.push_back(entry);
+}
+
+bool Assembler::insertRelocation(RelocationDefinition reloc){
+
+  // a pool entry holds a single value, so it needs at most one relocation
+  if(!SectionTable[reloc.section].relocationIndex.emplace(reloc.offset, RelocationTable.size()).second) return false;
+  RelocationTable.push_back(reloc);
+  return true;
+}
+
+void Assembler::generateRelocation(uint32_t symbolIndex , uint32_t entry, uint16_t sectionIndex){
+
+  if(SectionTable[sectionIndex].relocationIndex.count(entry)) return;
+
   RelocationDefinition newReloc;
   newReloc.addend = 0;
   newReloc.type = "R_X86_64_32";
@@ -1411,17 +1459,13 @@ void Assembler::generateRelocation(uint32_t symbolIndex , uint32_t entry, uint16
   newReloc.section = sectionIndex;
 
   if(SymbolTable[symbolIndex].global == false) {//locally symbols are not visible to linker   
-    string symName = SectionTable[sectionIndex].name;
-    for (auto i = 0; i< SymbolTable.size(); i++)
-      if (SymbolTable[i].label == symName){
-        newReloc.symbolIndex = i;
-        break;
-      }
+    int32_t sectionSymbol = findSymbol(SectionTable[sectionIndex].name);
+    if (sectionSymbol != -1) newReloc.symbolIndex = sectionSymbol;
 
     newReloc.addend = SymbolTable[symbolIndex].value;
   }
 
-  RelocationTable.push_back(newReloc);
+  insertRelocation(newReloc);
 }
 
 uint8_t Assembler::fetchRegister(string s){
@@ -1445,40 +1489,70 @@ void Assembler::unloadLiteralsPool()
   for(auto i =0; i< SectionTable.size(); i++){
     if (SectionTable[i].literalPool.size() != 0){
       for(LiteralsTable pool: SectionTable[i].literalPool){
-        SectionTable[i].data[pool.location] = pool.value & 0xff;
-        SectionTable[i].data[pool.location+1] = (pool.value>>8) & 0xff;
-        SectionTable[i].data[pool.location+2] = (pool.value>>16) & 0xff;
-        SectionTable[i].data[pool.location+3] = (pool.value>>24) & 0xff;
+        writeWord(i, pool.location, pool.value);
       }
       SectionTable[i].length = 
         SectionTable[i].literalPool[SectionTable[i].literalPool.size()-1].location + 4;
     }
+    reserveData(i, SectionTable[i].length);
   }
 }
 
-void Assembler::processCode(){
+void Assembler::readSource(){
   //opening input file
-  string line;
-
-  ifstream inputFileReader;
-  inputFileReader.open(inputPath);
-  if (inputFileReader.is_open() == false){
-    cout<<"Could not open input file."<<endl;
+  int descriptor = open(inputPath.c_str(), O_RDONLY);
+  if (descriptor < 0){
+    messages<<"Could not open input file."<<endl;
     return;
   }
 
-  while (getline(inputFileReader, line)){
-    line = regex_replace(line, regEmptySpace, " ");
-    line = regex_replace(line, regTabs, "");      
-    
-    inputCode.push_back(line);   
+  struct stat fileStatus;
+  if(fstat(descriptor, &fileStatus) == 0 && S_ISREG(fileStatus.st_mode)){
+    if(fileStatus.st_size == 0){
+      close(descriptor);
+      return;
+    }
+
+    void *mapping = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if(mapping != MAP_FAILED){
+      close(descriptor); // the mapping stays valid after the descriptor is closed
+      sourceMapping = mapping;
+      sourceMappingSize = fileStatus.st_size;
+      madvise(mapping, sourceMappingSize, MADV_SEQUENTIAL);
+      sourceCode = string_view((const char *)mapping, sourceMappingSize);
+      return;
+    }
   }
+
+  char buffer[4096];
+  ssize_t count;
+  while((count = read(descriptor, buffer, sizeof(buffer))) > 0){
+    sourceBuffer.append(buffer, count);
+  }
+  close(descriptor);
+  sourceCode = sourceBuffer;
+}
+
+void Assembler::unmapSource(){
+
+  if(sourceMapping == nullptr) return;
+  munmap(sourceMapping, sourceMappingSize);
+  sourceMapping = nullptr;
+  sourceMappingSize = 0;
+}
+
+void Assembler::processCode(){
+  Parser parser(sourceCode);
+  parser.parse(statements);
+}
+
+string Assembler::getTextOutputPath(){
+  return outputPath.substr(0, outputPath.length()-1) + "txt";
 }
 
 void Assembler::generateOutput(){
 
-  string outputTXT = outputPath.substr(0, outputPath.length()-1);
-  outputTXT+="txt";
+  string outputTXT = getTextOutputPath();
   ofstream ObjTXT(outputTXT);
 
   ObjTXT<< "Object file content:" << endl;
@@ -1541,16 +1615,16 @@ void Assembler::generateOutput(){
     uint32_t words = SectionTable[i].length - SectionTable[i].length % 4;
     for (auto j = 0; j< words; j+=4){
       ObjTXT<< hex<<setw(8) << setfill('0') << (SectionTable[i].base+j);
-      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +SectionTable[i].data[SectionTable[i].base+j];
-      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +SectionTable[i].data[SectionTable[i].base+j+1];
-      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +SectionTable[i].data[SectionTable[i].base+j+2];
-      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +SectionTable[i].data[SectionTable[i].base+j+3];
+      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +SectionTable[i].data[j];
+      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +SectionTable[i].data[j+1];
+      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +SectionTable[i].data[j+2];
+      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +SectionTable[i].data[j+3];
       ObjTXT<< endl;
     }
     if(words!= SectionTable[i].length){
       ObjTXT<< hex<<setw(8) << setfill('0') << (SectionTable[i].base+words);
       for(auto k = 0; k<SectionTable[i].length -words; k++  )
-        ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +SectionTable[i].data[SectionTable[i].base+k+words];
+        ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +SectionTable[i].data[k+words];
     }
      
     ObjTXT << dec; 
@@ -1559,103 +1633,255 @@ void Assembler::generateOutput(){
   ObjTXT << endl;
 
   ObjTXT.close();
-  cout<<"Text file generated in "<<outputTXT<<endl;
-  cout<<endl;
+  messages<<"Text file generated in "<<outputTXT<<endl;
+  messages<<endl;
 }
 
 void Assembler::generateBinary(){
   
   string outputBin = this->outputPath;
-  cout<<"Binary generated in "<<outputBin<<endl;
+  messages<<"Binary generated in "<<outputBin<<endl;
 
   ofstream outputFile(outputBin, ios::out | ios::binary);
-  
-  // Symbols
-  uint32_t symbols = SymbolTable.size();
-  outputFile.write((char *)&symbols, sizeof(symbols));
-  for (auto i = 0; i< SymbolTable.size();i++){     
-    outputFile.write((char *)(&i), sizeof(i));
-    uint32_t labelLen = SymbolTable[i].label.length();
-
-    outputFile.write((char *)(&labelLen), sizeof(labelLen));
-    outputFile.write(SymbolTable[i].label.c_str(), labelLen);
-
-    outputFile.write((char *)(&SymbolTable[i].section), sizeof(SymbolTable[i].section));
-    outputFile.write((char *)(&SymbolTable[i].defined), sizeof(SymbolTable[i].defined));
-    outputFile.write((char *)(&SymbolTable[i].external), sizeof(SymbolTable[i].external));
-    outputFile.write((char *)(&SymbolTable[i].global), sizeof(SymbolTable[i].global));
-    outputFile.write((char *)(&SymbolTable[i].value), sizeof(SymbolTable[i].value));   
-       
+
+  // names of symbols and sections are kept in the string table
+  string stringTable;
+
+  vector<ObjSymbol> symbols;
+  for (SymbolDefinition &symbol: SymbolTable){
+    symbols.push_back({(uint32_t)stringTable.size(), symbol.section, symbol.value,
+      symbol.global, symbol.external, symbol.defined, 0});
+    stringTable.append(symbol.label);
+    stringTable.push_back('\0');
   }
-  // Sections
-  uint32_t sections = SectionTable.size();
-  outputFile.write((char *)&sections, sizeof(sections));
 
-  for (auto i = 0; i< SectionTable.size(); i++){
-    outputFile.write((char *)(&i), sizeof(i));
-
-    uint32_t labelLen = SectionTable[i].name.length();
-    outputFile.write((char *)(&labelLen), sizeof(labelLen));
-    outputFile.write(SectionTable[i].name.c_str(), labelLen);
-
-    outputFile.write((char *)(&SectionTable[i].base), sizeof(SectionTable[i].base));
-    outputFile.write((char *)(&SectionTable[i].length), sizeof(SectionTable[i].length));
-        
-    // Data output
-    uint32_t dataSize  = SectionTable[i].length;
-    outputFile.write((char *)&dataSize, sizeof(dataSize));
-    for (auto j = 0; j< SectionTable[i].length; j++){
-      uint32_t adr0 = SectionTable[i].base + j;
-      outputFile.write((char *)(&adr0), sizeof(adr0));
-      int8_t value = SectionTable[i].data[SectionTable[i].base+j];
-      
-      outputFile.write((char *)(&value), sizeof(value));
-    }         
-  }      
-    // Relocations 
-  uint32_t relocs = RelocationTable.size();
-  
-  outputFile.write((char *)&relocs, sizeof(relocs));
-  for (auto i = 0; i< RelocationTable.size();i++){  
-    outputFile.write((char *)(&i), sizeof(i));   
-    outputFile.write((char *)(&RelocationTable[i].addend), sizeof(RelocationTable[i].addend));
-    outputFile.write((char *)(&RelocationTable[i].offset), sizeof(RelocationTable[i].offset));
-    outputFile.write((char *)(&RelocationTable[i].section), sizeof(RelocationTable[i].section));
-    outputFile.write((char *)(&RelocationTable[i].symbolIndex), sizeof(RelocationTable[i].symbolIndex));      
+  vector<ObjSection> sections;
+  for (SectionDefinition &section: SectionTable){
+    sections.push_back({(uint32_t)stringTable.size(), section.base, section.length});
+    stringTable.append(section.name);
+    stringTable.push_back('\0');
+  }
+
+  vector<ObjRelocation> relocations;
+  for (RelocationDefinition &reloc: RelocationTable){
+    relocations.push_back({reloc.section, reloc.offset, reloc.symbolIndex, reloc.addend, R_X86_64_32_TYPE});
+  }
+
+  ObjHeader header;
+  memcpy(header.magic, OBJ_MAGIC, sizeof(header.magic));
+  header.version = OBJ_VERSION;
+  header.symbols = symbols.size();
+  header.sections = sections.size();
+  header.relocations = relocations.size();
+  header.stringTableSize = stringTable.size();
 
+  outputFile.write((char *)&header, sizeof(header));
+  outputFile.write(stringTable.data(), stringTable.size());
+  outputFile.write((char *)symbols.data(), symbols.size() * sizeof(ObjSymbol));
+  outputFile.write((char *)sections.data(), sections.size() * sizeof(ObjSection));
+  for (SectionDefinition &section: SectionTable){
+    outputFile.write((char *)section.data.data(), section.length);
   }
-    outputFile.close();
+  outputFile.write((char *)relocations.data(), relocations.size() * sizeof(ObjRelocation));
+
+  outputFile.close();
 }
 
-int main(int argc, const char *argv[]){
+void Assembler::setCacheDirectory(string directory){
+  cacheDirectory = directory;
+}
 
-  string inputFile;
-  string outputFile;
+bool Assembler::fetchFromCache(){
+  if(cacheDirectory.empty()) return false;
+
+  // the cache and object format versions and the executable, followed by the source
+  uint64_t hash = 0xcbf29ce484222325;
+  uint64_t executable = getExecutableHash();
+  mixHash(hash, &CacheVersion, sizeof(CacheVersion));
+  mixHash(hash, &OBJ_VERSION, sizeof(OBJ_VERSION));
+  mixHash(hash, &executable, sizeof(executable));
+  mixHash(hash, sourceCode.data(), sourceCode.size());
+
+  stringstream key;
+  key<< hex<< setfill('0')<< setw(16)<< hash<< "-"<< dec<< sourceCode.size();
+  cacheKey = key.str();
+
+  filesystem::path entry = filesystem::path(cacheDirectory) / cacheKey;
+  error_code error;
+  if(!filesystem::exists(entry.string() + ".o", error) || !filesystem::exists(entry.string() + ".txt", error)){
+    return false;
+  }
+
+  auto options = filesystem::copy_options::overwrite_existing;
+  if(!filesystem::copy_file(entry.string() + ".o", outputPath, options, error)
+    || !filesystem::copy_file(entry.string() + ".txt", getTextOutputPath(), options, error)){
+    messages<<"Could not copy "<<cacheKey<<" from the cache: "<<error.message()<<"."<<endl;
+    return false;
+  }
+
+  messages<<"Unchanged, copied from the cache."<<endl;
+  messages<<"Binary generated in "<<outputPath<<endl;
+  messages<<"Text file generated in "<<getTextOutputPath()<<endl;
+  messages<<endl;
+  return true;
+}
+
+void Assembler::mixHash(uint64_t &hash, const void *bytes, size_t size){
+
+  for(size_t i = 0; i < size; i++){
+    hash ^= ((const uint8_t *)bytes)[i];
+    hash *= 0x100000001b3;
+  }
+}
+
+uint64_t Assembler::getExecutableHash(){
+
+  // computed once for all assemblers of the run, the initialization is thread safe
+  static uint64_t executableHash = [](){
+    int descriptor = open("/proc/self/exe", O_RDONLY);
+    if(descriptor < 0) return (uint64_t)0;
+
+    uint64_t hash = 0xcbf29ce484222325;
+    char buffer[65536];
+    ssize_t count;
+    while((count = read(descriptor, buffer, sizeof(buffer))) > 0){
+      mixHash(hash, buffer, count);
+    }
+    close(descriptor);
+    return count < 0 ? (uint64_t)0 : hash;
+  }();
+
+  return executableHash;
+}
+
+void Assembler::storeInCache(){
+  if(cacheDirectory.empty()) return;
+
+  error_code error;
+  filesystem::create_directories(cacheDirectory, error);
+  if(error){
+    messages<<"Could not create the cache directory "<<cacheDirectory<<": "<<error.message()<<"."<<endl;
+    return;
+  }
+
+  // entries are copied under a name of their own and renamed, so assemblers running at the same time
+  // never see a partial entry
+  filesystem::path entry = filesystem::path(cacheDirectory) / cacheKey;
+  stringstream temporary;
+  temporary<< ".tmp"<< getpid()<< "-"<< this_thread::get_id();
+  auto options = filesystem::copy_options::overwrite_existing;
+  string outputs[2][2] = {{outputPath, entry.string() + ".o"}, {getTextOutputPath(), entry.string() + ".txt"}};
+  for(auto &output: outputs){
+    string copy = output[1] + temporary.str();
+    filesystem::copy_file(output[0], copy, options, error);
+    if(!error) filesystem::rename(copy, output[1], error);
+    if(error){
+      messages<<"Could not store "<<output[0]<<" in the cache: "<<error.message()<<"."<<endl;
+      filesystem::remove(copy, error);
+      return;
+    }
+  }
+}
+
+void Assembler::setSinglePass(bool enabled){
+  singlePassMode = enabled;
+}
+
+int main(int argc, const char *argv[]){
 
   if(argc == 1){
     cout<<"No input file to assemble."<<endl;
     return -2;
   }
-  if (strcmp(argv[1], "-o")==0){
-    if(argc != 4){
+
+  vector<string> inputFiles;
+  string outputFile;
+  string cacheDirectory;
+  bool singlePass = false;
+  uint32_t threads = thread::hardware_concurrency();
+  regex regThreads("^-threads=([1-9][0-9]*)$");
+  smatch threadCount;
+  for(auto i = 1; i < argc; i++){
+    string param = argv[i];
+    if(param == "-o"){
+      if(i + 1 == argc){
+        cout<<"Inappropriate number of arguments for assembly."<<endl;
+        return -2;
+      }
+      outputFile = argv[++i];
+    }
+    else if(param == "-single-pass"){
+      singlePass = true;
+    }
+    else if(param.rfind("-cache=", 0) == 0){
+      cacheDirectory = param.substr(strlen("-cache="));
+    }
+    else if(param.rfind("-threads=", 0) == 0){
+      if(!regex_search(param, threadCount, regThreads) || threadCount.str(1).size() > 9){
+        cout<<"Inappropriate number of threads: "<<param<<"."<<endl;
+        return -2;
+      }
+      threads = stoul(threadCount.str(1));
+    }
+    else{
+      inputFiles.push_back(param);
+    }
+  }
+  if(threads == 0) threads = 1;
+
+  if(!outputFile.empty()){
+    if(inputFiles.size() != 1){
       cout<<"Inappropriate number of arguments for assembly."<<endl;
       return -2;
     }
-    
-    inputFile = argv[3];
-    outputFile = argv[2];
-  }
 
-  else{
-   inputFile = argv[1];    
+    Assembler assembler(inputFiles[0], outputFile);
+    assembler.setCacheDirectory(cacheDirectory);
+    assembler.setSinglePass(singlePass);
+    return assembler.assemble() ? 0 : -1;
   }
 
-  string l = "ld value1, %pc";
-  smatch atom;
+  // batch mode: every input is assembled into an object file of the same name, which must not
+  // replace the input itself
+  vector<string> objectFiles;
+  for(string &inputFile: inputFiles){
+    filesystem::path objectFile = filesystem::path(inputFile).replace_extension(".o");
+    filesystem::path textFile = filesystem::path(inputFile).replace_extension(".txt");
+    if(objectFile == filesystem::path(inputFile) || textFile == filesystem::path(inputFile)){
+      cout<<"Output of "<<inputFile<<" would overwrite the input file."<<endl;
+      return -2;
+    }
+    objectFiles.push_back(objectFile.string());
+  }
+
+  // assemblers are independent, every one writes its messages into its own log
+  vector<ostringstream> logs(inputFiles.size());
+  vector<uint8_t> assembled(inputFiles.size(), false);
+  atomic<uint32_t> nextFile(0);
+  auto worker = [&](){
+    for(uint32_t i = nextFile++; i < inputFiles.size(); i = nextFile++){
+      Assembler assembler(inputFiles[i], objectFiles[i], logs[i]);
+      assembler.setCacheDirectory(cacheDirectory);
+      assembler.setSinglePass(singlePass);
+      assembled[i] = assembler.assemble();
+    }
+  };
 
-  Assembler assembler(inputFile, outputFile);
+  vector<thread> pool;
+  for(auto i = 1; i < threads && i < inputFiles.size(); i++){
+    pool.push_back(thread(worker));
+  }
+  worker();
+  for(thread &t: pool){
+    t.join();
+  }
 
-  assembler.assemble();
+  // logs are printed in the order of the inputs
+  bool successful = true;
+  for(auto i = 0; i < inputFiles.size(); i++){
+    cout<<logs[i].str();
+    successful &= assembled[i];
+  }
 
-  return 0;
-}
\ No newline at end of file
+  return successful ? 0 : -1;
+}
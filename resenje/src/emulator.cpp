@@ -6,10 +6,91 @@ Emulator::Emulator(string input):inputFile(input),registers(GPR_NUMBER, 0x0),
 {
   errorDetected = false;
   running = false;
+  image = nullptr;
+  imageSize = 0;
   ldMem = false;
   iret = false;
   terminalError ="";
-  memory[TIM_CFG] = 0;
+  engine = SWITCH_ENGINE;
+  timerMode = REALTIME_TIMER;
+  executedInstructions = 0;
+  previousSample = 0;
+  timerStart = 0;
+  instructionsPerMs = 1000;
+  sampleInterval = 1024;
+  inputHead = 0;
+  inputTail = 0;
+  inputRunning = false;
+  bufferedOutput = true;
+  outputPending = false;
+  lastOutput = 0;
+  profiling = false;
+  setupHandlers();
+  setupMmio();
+  Page *timerPage = allocatePage(TIM_CFG);
+  timerPage->data[TIM_CFG & PAGE_MASK] = 0;
+  setMapped(timerPage, TIM_CFG);
+}
+
+Emulator::~Emulator(){
+
+  stopInput();
+  unmapImage();
+}
+
+bool Emulator::processOption(string option){
+
+  if(option == "-profile"){
+    profiling = true;
+    return true;
+  }
+
+  if(option == "-engine=switch"){
+    engine = SWITCH_ENGINE;
+    return true;
+  }
+  if(option == "-engine=threaded"){
+    engine = THREADED_ENGINE;
+    return true;
+  }
+  if(option == "-engine=block"){
+    engine = BLOCK_ENGINE;
+    return true;
+  }
+  if(option == "-output=buffered"){
+    bufferedOutput = true;
+    return true;
+  }
+  if(option == "-output=unbuffered"){
+    bufferedOutput = false;
+    return true;
+  }
+  if(option == "-timer=realtime"){
+    timerMode = REALTIME_TIMER;
+    return true;
+  }
+  if(option == "-timer=virtual"){
+    timerMode = VIRTUAL_TIMER;
+    return true;
+  }
+
+  string instructionsOption = "-instructions-per-ms=";
+  string sampleOption = "-timer-sample=";
+  try{
+    if(option.substr(0, instructionsOption.length()) == instructionsOption){
+      instructionsPerMs = stoull(option.substr(instructionsOption.length()));
+      return instructionsPerMs != 0;
+    }
+    if(option.substr(0, sampleOption.length()) == sampleOption){
+      sampleInterval = stoull(option.substr(sampleOption.length()));
+      return sampleInterval != 0;
+    }
+  }
+  catch(exception &){
+    return false;
+  }
+
+  return false;
 }
 
 
@@ -21,53 +102,107 @@ bool Emulator::processInput(){
 
     return false;
   }
-  ifstream inputFileReader(inputFile, ios::binary);
-  if (inputFileReader.fail()){
+  int descriptor = open(inputFile.c_str(), O_RDONLY);
+  if (descriptor < 0){
+    cout<<"Input file "<< inputFile<< " cannot be opened."<<endl;
+    errorDetected = true; 
+    return false;
+  }
+
+  struct stat fileStatus;
+  if(fstat(descriptor, &fileStatus) < 0 || fileStatus.st_size < (off_t)sizeof(uint32_t)){
+    close(descriptor);
+    cout<<"Input file "<< inputFile<< " is not a valid executable."<<endl;
+    errorDetected = true; 
+    return false;
+  }
+
+  imageSize = fileStatus.st_size;
+  void *mapping = mmap(nullptr, imageSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  close(descriptor); // the mapping stays valid after the descriptor is closed
+  if(mapping == MAP_FAILED){
+    imageSize = 0;
     cout<<"Input file "<< inputFile<< " cannot be opened."<<endl;
     errorDetected = true; 
     return false;
   }
+  image = (const int8_t *)mapping;
+  madvise(mapping, imageSize, MADV_SEQUENTIAL);
 
+  size_t position = 0;
   uint32_t segments = 0;
-  inputFileReader.read((char *)&segments, sizeof(segments));
+  memcpy(&segments, image + position, sizeof(segments));
+  position += sizeof(segments);
   
   for (auto i= 0; i < segments; i++){
     Segment readSegment;
 
-    inputFileReader.read((char *)&readSegment.virtualAddress, sizeof(readSegment.virtualAddress));
-    inputFileReader.read((char *)&readSegment.size, sizeof(readSegment.size));
-   
-    for (auto j= 0; j< readSegment.size; j++){
-      int8_t val;
-      inputFileReader.read((char *)(&val), sizeof(val));
-      readSegment.data.push_back(val);
+    if(imageSize - position < sizeof(readSegment.virtualAddress) + sizeof(readSegment.size)){
+      cout<<"Input file "<< inputFile<< " is not a valid executable."<<endl;
+      errorDetected = true; 
+      return false;
+    }
+    memcpy(&readSegment.virtualAddress, image + position, sizeof(readSegment.virtualAddress));
+    position += sizeof(readSegment.virtualAddress);
+    memcpy(&readSegment.size, image + position, sizeof(readSegment.size));
+    position += sizeof(readSegment.size);
+
+    if(imageSize - position < readSegment.size){
+      cout<<"Input file "<< inputFile<< " is not a valid executable."<<endl;
+      errorDetected = true; 
+      return false;
     }
+    readSegment.data = image + position;
+    position += readSegment.size;
 
   this->segments.push_back(readSegment);
   }
 
-  inputFileReader.close();
   return true;
 }
 
 bool Emulator::loadData(){
 
   for(auto i = 0; i < segments.size(); i++){
-    if (segments[i].virtualAddress + segments.size() >= MEMORY_MAPPED_REGISTERS_ADDRESS){
+    if ((uint64_t)segments[i].virtualAddress + segments[i].size > MEMORY_MAPPED_REGISTERS_ADDRESS){
         errorDetected = true;
         cout<< "Segment to load into inaccessable area."<< endl;
         return false;
     }
-    for(auto j = 0; j< segments[i].data.size(); j++){
-      memory[segments[i].virtualAddress + j] = segments[i].data[j];
+    // copies the part of the segment that falls into each page at once
+    uint32_t loaded = 0;
+    while(loaded < segments[i].size){
+      uint32_t address = segments[i].virtualAddress + loaded;
+      uint32_t offset = address & PAGE_MASK;
+      uint32_t chunk = min(PAGE_SIZE - offset, segments[i].size - loaded);
+
+      Page *page = allocatePage(address);
+      memcpy(page->data + offset, segments[i].data + loaded, chunk);
+      setMappedRange(page, offset, chunk);
+      loaded += chunk;
     }
   }
 
+  // everything is in guest memory now, the file pages are no longer needed
+  segments.clear();
+  unmapImage();
+
   return true;
 }
 
+void Emulator::unmapImage(){
+
+  if(image == nullptr) return;
+  munmap((void *)image, imageSize);
+  image = nullptr;
+  imageSize = 0;
+}
+
 void Emulator::emulate(){
 
+  // nothing has been written to stdout yet, so its buffer can still be replaced
+  if(bufferedOutput) setvbuf(stdout, nullptr, _IOFBF, OUTPUT_BUFFER_SIZE);
+
   regPC= START;
   regSP = MEMORY_MAPPED_REGISTERS_ADDRESS;
 
@@ -77,38 +212,119 @@ void Emulator::emulate(){
     cout<< "Error configuring terminal. Emulation not initialized:"<<terminalError<<endl;
     return;
   }
+  startInput();
+
+  if(profiling){
+    loadSymbolMap();
+    callNodes.clear();
+    enterCall(START);
+    currentNode = 0;
+  }
 
   running = true;
 
   while (running){
-    currentPC = regPC;
-    if(fetchAndDecodeInstruction())
-      executeInstruction();
+    // translated blocks don't stop between instructions, so profiling always goes one by one
+    if(engine == BLOCK_ENGINE && !profiling){
+      runBlock();
+    }
+    else{
+      currentPC = regPC;
+      if(fetchAndDecodeInstruction()){
+        uint32_t next = regPC;
+        if(profiling) profileInstruction();
+        if(engine == SWITCH_ENGINE)
+          executeInstruction();
+        else
+          (this->*currentHandler)();
+        if(profiling) profileControlFlow(next);
+      }
+      executedInstructions++;
+    }
 
-    if(!running) return; // hard fault, immediate exit
+    if(!running){ // halt or hard fault, immediate exit
+      flushTerminal();
+      return;
+    }
 
     timerTick();
     readTerminal();
+    flushIdleTerminal();
     handleInterrupt();
   }
+  flushTerminal();
   resetTerminal();
 }
 
+Emulator::Page *Emulator::findPage(uint32_t address){
+
+  PageTable *table = pageDirectory[address >> (PAGE_BITS + TABLE_BITS)].get();
+  if(table == nullptr) return nullptr;
+
+  return table->pages[(address >> PAGE_BITS) & (TABLE_SIZE - 1)].get();
+}
+
+Emulator::Page *Emulator::allocatePage(uint32_t address){
+
+  unique_ptr<PageTable> &table = pageDirectory[address >> (PAGE_BITS + TABLE_BITS)];
+  if(!table) table.reset(new PageTable());
+
+  unique_ptr<Page> &page = table->pages[(address >> PAGE_BITS) & (TABLE_SIZE - 1)];
+  if(!page) page.reset(new Page()); // value initialized, so nothing is marked as mapped
+
+  return page.get();
+}
+
+bool Emulator::isMapped(Page *page, uint32_t address){
+
+  uint32_t offset = address & PAGE_MASK;
+  return (page->mapped[offset >> 6] >> (offset & 63)) & 1;
+}
+
+void Emulator::setMapped(Page *page, uint32_t address){
+
+  uint32_t offset = address & PAGE_MASK;
+  page->mapped[offset >> 6] |= (uint64_t)1 << (offset & 63);
+}
+
+void Emulator::setMappedRange(Page *page, uint32_t offset, uint32_t size){
+
+  uint32_t end = offset + size;
+  while(offset < end){
+    uint32_t bit = offset & 63;
+    uint32_t count = min((uint32_t)64 - bit, end - offset);
+    uint64_t bits = count == 64 ? ~(uint64_t)0 : (((uint64_t)1 << count) - 1);
+    page->mapped[offset >> 6] |= bits << bit;
+    offset += count;
+  }
+}
+
 int8_t Emulator::readMem(uint32_t address){
 
-  if(memory.find(address) == memory.end()){
+  Page *page = findPage(address);
+  if(page == nullptr || !isMapped(page, address)){
     cout<<"Access out of allocated space at " << hex << address << ".";
     handleFault();
     return 0;
   }
 
-  return memory[address] & 0xff;
+  return page->data[address & PAGE_MASK] & 0xff;
 }
 
 int32_t Emulator::readMemWord(uint32_t address){
 
   if(address+3 >= MEMORY_SIZE) return 0x0;
-  
+
+  uint32_t offset = address & PAGE_MASK;
+  if(offset <= PAGE_SIZE - WORD){
+    Page *page = findPage(address);
+    if(page != nullptr && isWordMapped(page, offset)){
+      uint8_t *bytes = (uint8_t *)page->data + offset;
+      return (int32_t)(bytes[0] | bytes[1]<<8 | bytes[2]<<16 | (uint32_t)bytes[3]<<24);
+    }
+  }
+
+  // crosses a page or touches unmapped bytes, which has to fault on the exact byte
   uint32_t byte0 = (uint32_t)readMem(address);
   uint32_t byte1 = (uint32_t)readMem(address+ 1);
   uint32_t byte2 = (uint32_t)readMem(address+ 2);
@@ -119,11 +335,16 @@ int32_t Emulator::readMemWord(uint32_t address){
 
 void Emulator::writeMem(int8_t value, uint32_t address){
 
-  memory[address] = value;
-  if(address == TERM_OUT) cout<<(char)value<<flush;  // if there is data written inside 
-  // memory mapped terminal output register, display it
-  if(address == TIMER_CFG) resetTimer(value); // configure timer immediately resets it with a newly
-  //set period
+  Page *page = allocatePage(address);
+  page->data[address & PAGE_MASK] = value;
+  setMapped(page, address);
+  invalidateDecoded(page, address);
+  invalidateTranslated(page, address, ADDRESSABLE_UNIT);
+
+  if(address >= MEMORY_MAPPED_REGISTERS_ADDRESS){
+    MmioHandler mmioHandler = mmioHandlers[address - MEMORY_MAPPED_REGISTERS_ADDRESS];
+    if(mmioHandler != nullptr) (this->*mmioHandler)(value);
+  }
 }
 
 void Emulator::writeMemWord(int32_t value, uint32_t address){
@@ -137,6 +358,26 @@ void Emulator::writeMemWord(int32_t value, uint32_t address){
     cout<<"Out of bounds write at "<< regPC <<"."<< endl;
     return; // out of bounds write
   }
+
+  uint32_t offset = address & PAGE_MASK;
+  if(address + 3 < MEMORY_MAPPED_REGISTERS_ADDRESS && offset <= PAGE_SIZE - WORD){
+    Page *page = allocatePage(address);
+    int8_t *bytes = page->data + offset;
+    bytes[0] = byte0;
+    bytes[1] = byte1;
+    bytes[2] = byte2;
+    bytes[3] = byte3;
+
+    if((offset & 63) <= 60)
+      page->mapped[offset >> 6] |= (uint64_t)0xf << (offset & 63);
+    else
+      for(auto i = 0; i < WORD; i++) setMapped(page, address + i);
+
+    invalidateDecoded(page, address);
+    invalidateDecoded(page, address + 3);
+    invalidateTranslated(page, address, WORD);
+    return;
+  }
     
   writeMem(byte0, address);
   writeMem(byte1, address+ 1);
@@ -144,6 +385,38 @@ void Emulator::writeMemWord(int32_t value, uint32_t address){
   writeMem(byte3, address+ 3);
 }
 
+bool Emulator::isWordMapped(Page *page, uint32_t offset){
+
+  if((offset & 63) <= 60)
+    return ((page->mapped[offset >> 6] >> (offset & 63)) & 0xf) == 0xf;
+
+  for(auto i = 0; i < WORD; i++)
+    if(!((page->mapped[(offset + i) >> 6] >> ((offset + i) & 63)) & 1)) return false;
+
+  return true;
+}
+
+void Emulator::invalidateTranslated(Page *page, uint32_t address, uint32_t size){
+
+  for(uint32_t i = 0; i < size; i++){
+    uint32_t offset = (address + i) & PAGE_MASK;
+    if((page->translated[offset >> 6] >> (offset & 63)) & 1){
+      invalidateBlocks(page, address, size);
+      return;
+    }
+  }
+}
+
+void Emulator::setupMmio(){
+
+  for(auto i = 0; i < MEMORY_MAPPED_REGISTERS_SIZE; i++)
+    mmioHandlers[i] = nullptr;
+
+  // if there is data written inside memory mapped terminal output register, display it
+  mmioHandlers[TERM_OUT - MEMORY_MAPPED_REGISTERS_ADDRESS] = &Emulator::writeTerminal;
+  mmioHandlers[TIMER_CFG - MEMORY_MAPPED_REGISTERS_ADDRESS] = &Emulator::writeTimerConfig;
+}
+
 void Emulator::push(int32_t value){
 
   regSP -= 4;
@@ -166,7 +439,284 @@ int32_t Emulator::pop(){
   return value;
 }
 
-bool Emulator::fetchAndDecodeInstruction(){ // check if the operands are appropriately set and proceed
+bool Emulator::fetchAndDecodeInstruction(){
+
+  uint32_t address = regPC;
+  DecodedInstruction *cached = findDecoded(address);
+
+  if(cached != nullptr && cached->valid){
+    op = cached->op;
+    regA = cached->regA;
+    regB = cached->regB;
+    regC = cached->regC;
+    displacement = cached->displacement;
+    ldMem = cached->ldMem;
+    iret = cached->iret;
+    currentHandler = cached->handler;
+    regPC += cached->size;
+    return true;
+  }
+
+  if(!decodeInstruction()) return false;
+
+  currentHandler = handlers[op];
+
+  // faulting instructions are never cached, they stop the emulation anyway
+  if(cached != nullptr && running){
+    *cached = {true, op, regA, regB, regC, displacement, ldMem, iret, (uint8_t)(regPC - address),
+      currentHandler};
+  }
+
+  return true;
+}
+
+Emulator::DecodedInstruction *Emulator::findDecoded(uint32_t address){
+
+  if(address & 0x3) return nullptr;
+
+  Page *page = findPage(address);
+  if(page == nullptr) return nullptr;
+
+  if(!page->decoded) page->decoded.reset(new DecodedInstruction[PAGE_SIZE / 4]());
+
+  return &page->decoded[(address & PAGE_MASK) >> 2];
+}
+
+void Emulator::invalidateDecoded(Page *page, uint32_t address){
+
+  // instructions are at most 8 bytes long, so only the one starting in the written word
+  // and the one starting in the word before can contain the written byte
+  uint32_t word = (address & PAGE_MASK) >> 2;
+
+  if(page->decoded){
+    page->decoded[word].valid = false;
+    if(word != 0) page->decoded[word - 1].valid = false;
+  }
+
+  if(word == 0){
+    Page *previous = findPage(address - 4);
+    if(previous != nullptr && previous->decoded)
+      previous->decoded[PAGE_SIZE / 4 - 1].valid = false;
+  }
+}
+
+void Emulator::runBlock(){
+
+  unordered_map<uint32_t, BasicBlock>::iterator block = blocks.find(regPC);
+
+  if(block != blocks.end() && !block->second.valid){
+    blocks.erase(block);
+    block = blocks.end();
+  }
+
+  if(block == blocks.end())
+    translateBlock();
+  else
+    executeBlock(block->second);
+}
+
+void Emulator::translateBlock(){
+
+  uint32_t start = regPC;
+  BasicBlock block;
+  block.valid = true;
+  blockInvalidated = false;
+
+  while(true){
+    currentPC = regPC;
+    if(!fetchAndDecodeInstruction()) return;
+
+    MicroOp microOp;
+    microOp.kind = GENERIC_OP;
+    microOp.instruction = {true, op, regA, regB, regC, displacement, ldMem, iret,
+      (uint8_t)(regPC - currentPC), currentHandler};
+    microOp.next = regPC;
+    microOp.constant = 0;
+    int32_t index = registers[regC]; // the handler may overwrite it when regA == regC
+
+    (this->*currentHandler)();
+    executedInstructions++;
+    if(!running || blockInvalidated) return; // nothing is recorded for a block that didn't complete
+
+    switch(op){
+      case ADD: case SUB: case MUL: case AND: case OR: case XOR: case SHL: case SHR: case NOT:
+      case LD_REG:{
+        if(regA != pc && regB != pc && regC != pc) microOp.kind = REGISTER_OP;
+        break;
+      }
+      case LD_REG_IND:{
+        // ld $value, %reg reads its operand from the literal pool, the loaded value is kept
+        // as long as the pool entry isn't overwritten and the index register stays zero
+        if(regB == pc && index == 0 && regA != pc && !microOp.instruction.ldMem){
+          microOp.kind = CONSTANT_OP;
+          microOp.constant = registers[regA];
+          markTranslated(microOp.next + displacement, WORD);
+        }
+        break;
+      }
+    }
+
+    markTranslated(currentPC, microOp.instruction.size);
+    block.ops.push_back(microOp);
+
+    if(endsBlock(microOp) || regPC != microOp.next || block.ops.size() == MAX_BLOCK_SIZE) break;
+  }
+
+  block.end = block.ops.back().next;
+
+  for(MicroOp &microOp: block.ops){
+    indexBlock(start, microOp.next - microOp.instruction.size, microOp.instruction.size);
+    if(microOp.kind == CONSTANT_OP)
+      indexBlock(start, microOp.next + microOp.instruction.displacement, WORD);
+  }
+
+  blocks[start] = block;
+}
+
+void Emulator::executeBlock(BasicBlock &block){
+
+  blockInvalidated = false;
+
+  for(MicroOp &microOp: block.ops){
+    DecodedInstruction &instruction = microOp.instruction;
+    executedInstructions++;
+
+    switch(microOp.kind){
+      case REGISTER_OP:{
+        int32_t valueB = registers[instruction.regB];
+        int32_t valueC = registers[instruction.regC];
+        int32_t &destination = registers[instruction.regA];
+
+        switch(instruction.op){
+          case ADD: destination = valueB + valueC; break;
+          case SUB: destination = valueB - valueC; break;
+          case MUL: destination = valueB * valueC; break;
+          case AND: destination = valueB & valueC; break;
+          case OR: destination = valueB | valueC; break;
+          case XOR: destination = valueB ^ valueC; break;
+          case SHL: destination = valueB << valueC; break;
+          case SHR: destination = valueB >> valueC; break;
+          case NOT: destination = ~valueB; break;
+          case LD_REG: destination = valueB + instruction.displacement; break;
+        }
+        break;
+      }
+      case CONSTANT_OP:{
+        if(registers[instruction.regC] == 0){
+          registers[instruction.regA] = microOp.constant;
+          break;
+        }
+        // the literal was folded for a zero index, any other index reads a different word
+        [[fallthrough]];
+      }
+      case GENERIC_OP:{
+        regPC = microOp.next;
+        op = instruction.op;
+        regA = instruction.regA;
+        regB = instruction.regB;
+        regC = instruction.regC;
+        displacement = instruction.displacement;
+        ldMem = instruction.ldMem;
+        iret = instruction.iret;
+
+        (this->*instruction.handler)();
+        if(!running || blockInvalidated || regPC != microOp.next) return;
+        break;
+      }
+    }
+  }
+
+  regPC = block.end;
+}
+
+bool Emulator::endsBlock(MicroOp &microOp){
+
+  DecodedInstruction &instruction = microOp.instruction;
+
+  switch(instruction.op){
+    case HALT: case INT: case CALL: case JMP: case BEQ: case BNE: case BGT: return true;
+    case XCHG: return instruction.regB == pc || instruction.regC == pc;
+    case ST_REG_MEM: case ST_REG_IND: case CSRWR: case PUSH: return false;
+    default: return instruction.regA == pc; // pop pc also covers ret and iret
+  }
+}
+
+void Emulator::markTranslated(uint32_t address, uint32_t size){
+
+  for(uint32_t i = 0; i < size; i++){
+    Page *page = allocatePage(address + i);
+    uint32_t offset = (address + i) & PAGE_MASK;
+    page->translated[offset >> 6] |= (uint64_t)1 << (offset & 63);
+  }
+}
+
+void Emulator::markBlock(BasicBlock &block){
+
+  for(MicroOp &microOp: block.ops){
+    markTranslated(microOp.next - microOp.instruction.size, microOp.instruction.size);
+    if(microOp.kind == CONSTANT_OP)
+      markTranslated(microOp.next + microOp.instruction.displacement, WORD);
+  }
+}
+
+void Emulator::indexBlock(uint32_t start, uint32_t address, uint32_t size){
+
+  // a range spans at most two pages, a block is listed once per page
+  uint32_t pages[] = {address >> PAGE_BITS, (address + size - 1) >> PAGE_BITS};
+
+  for(uint32_t number: pages){
+    vector<uint32_t> &starts = pageBlocks[number];
+    if(find(starts.begin(), starts.end(), start) == starts.end()) starts.push_back(start);
+  }
+}
+
+bool Emulator::blockDependsOn(BasicBlock &block, uint32_t address, uint32_t size){
+
+  for(MicroOp &microOp: block.ops){
+    uint32_t start = microOp.next - microOp.instruction.size;
+    uint32_t literal = microOp.next + microOp.instruction.displacement;
+
+    if(address < microOp.next && address + size > start) return true;
+    if(microOp.kind == CONSTANT_OP && address < literal + WORD && address + size > literal)
+      return true;
+  }
+
+  return false;
+}
+
+void Emulator::invalidateBlocks(Page *page, uint32_t address, uint32_t size){
+
+  // the running block stops after the current instruction, a block that is being recorded
+  // isn't listed yet and is dropped as well
+  blockInvalidated = true;
+
+  unordered_map<uint32_t, vector<uint32_t>>::iterator indexed = pageBlocks.find(address >> PAGE_BITS);
+  vector<uint32_t> remaining;
+
+  if(indexed != pageBlocks.end()){
+    for(uint32_t start: indexed->second){
+      unordered_map<uint32_t, BasicBlock>::iterator block = blocks.find(start);
+      if(block == blocks.end() || !block->second.valid) continue; // already dropped
+
+      if(blockDependsOn(block->second, address, size))
+        block->second.valid = false;
+      else
+        remaining.push_back(start);
+    }
+
+    if(remaining.empty())
+      pageBlocks.erase(indexed);
+    else
+      indexed->second = remaining;
+  }
+
+  // the page keeps only the bits of the blocks that are still valid, so later writes to the
+  // dropped code or literals don't come back here
+  fill(begin(page->translated), end(page->translated), 0);
+  for(uint32_t start: remaining) markBlock(blocks[start]);
+}
+
+bool Emulator::decodeInstruction(){ // check if the operands are appropriately set and proceed
 
   op = readMem(regPC);
   ++regPC;
@@ -346,145 +896,260 @@ bool Emulator::fetchAndDecodeInstruction(){ // check if the operands are appropr
 bool Emulator::executeInstruction(){
   
   switch (op){
-    case HALT:{
-      running = false;
-      return true;
-    }
-    case INT:{
-      // interruption of this kind is synchronously called
-      // status<=status&(~0x1); pc<=handle;
-      csrCause = software_interrupt;
-      processSubroutine();
-      return true;
-    }
-    case CALL:{
-      // CALL
-      push(regPC);
-      regPC = readMemWord(regPC + displacement);
-      return true;    
-    }
-    case BEQ:{
-      if(registers[regB] == registers[regC])
-        regPC = readMemWord(registers[regA] + displacement);
-      return true;  
-    } 
-    case BNE:{
-      if(registers[regB] != registers[regC])
-        regPC = readMemWord(registers[regA] + displacement);
-      return true; 
-    } 
-    case BGT:{
-      if(registers[regB] > registers[regC])
-        regPC = readMemWord(registers[regA] + displacement);
-      return true;  
-    } 
-    case JMP:{
-      regPC = readMemWord(registers[regA] + displacement);
-      return true;
-    }
-    case PUSH:{
-      registers[regA]+= displacement;
-      writeMemWord(registers[regC], registers[regA]);
-      return true;
-    } 
-    case POP:{ 
-      registers[regA] = readMemWord(registers[regB]);
-      registers[regB]+= displacement;
-      if(iret == true){
-        csrStatus = readMemWord(registers[regB]);
-        registers[regB]+= displacement;
-        iret = false;
-        csrCause = 0;
-      }
-      return true;
-    }
-    case ADD:{
-      registers[regA] = registers[regB] + registers[regC];
-      return true;
-    }
-    case SUB:{
-      registers[regA] = registers[regB] - registers[regC];
-      return true;
-    }
-    case MUL:{
-      registers[regA] = registers[regB] * registers[regC];
-      return true;
-    } 
-    case DIV:{
-      if(registers[regC] == 0){
-        cout<<"Illegal zero divisor at "<< hex<<to_string(regPC) << "." <<endl;
-        cout<<dec;
-        handleFault();
-        return false;
-      }
-      registers[regA] = registers[regB] / registers[regC];
-      return true;
-    }
-    case AND:{
-      registers[regA] = registers[regB] & registers[regC];
-      return true;
-    } 
-    case OR:{
-      registers[regA] = registers[regB] | registers[regC];
-      return true;
-    } 
-    case XOR:{
-      registers[regA] = registers[regB] ^ registers[regC];
-      return true;
-    }
-    case SHL:{
-      registers[regA] = registers[regB] << registers[regC];
-      return true;
-    }
-    case SHR:{
-      registers[regA] = registers[regB] >> registers[regC];
-      return true;
-    } 
-    case XCHG:{
-      int32_t temp = registers[regB];
-      registers[regB] = registers[regC];
-      registers[regC] = temp;
-      return true;
-    }
-    case NOT:{
-      registers[regA] = ~registers[regB];
-      return true;         
-    }
-    case LD_REG_IND:{ // also for immediate and register-memory
-      registers[regA] = readMemWord(registers[regB]+ registers[regC] + displacement);
-      if(ldMem){
-        ldMem = false;
-        registers[regA] = readMemWord(registers[regA]);
-      }
-      return true;    
-    }
-    case LD_REG:{
-      registers[regA] =registers[regB] + displacement;
-      return true;       
-    }
-    case ST_REG_MEM:{
-      uint32_t address = readMemWord(registers[regA]+ registers[regB]+ displacement);
-      writeMemWord(registers[regC], address);
-      return true;      
-    }
-    case ST_REG_IND:{
-      writeMemWord(registers[regC], registers[regA]+registers[regB]+displacement);
-      return true;
-    }
-    case CSRRD:{ 
-      registers[regA] = csrRegisters[regB]; 
-      return true;   
-    }
-    case CSRWR:{
-      csrRegisters[regA] = registers[regB];
-      return true;
-    }
-    default:
-        cout<< "Illegal operation code at "<< hex<<to_string(regPC)<<"."<< endl;
-        cout<<dec;
-        handleFault();
-        return false;
-    }
+    case HALT: return executeHalt();
+    case INT: return executeInt();
+    case CALL: return executeCall();
+    case BEQ: return executeBeq();
+    case BNE: return executeBne();
+    case BGT: return executeBgt();
+    case JMP: return executeJmp();
+    case PUSH: return executePush();
+    case POP: return executePop();
+    case ADD: return executeAdd();
+    case SUB: return executeSub();
+    case MUL: return executeMul();
+    case DIV: return executeDiv();
+    case AND: return executeAnd();
+    case OR: return executeOr();
+    case XOR: return executeXor();
+    case SHL: return executeShl();
+    case SHR: return executeShr();
+    case XCHG: return executeXchg();
+    case NOT: return executeNot();
+    case LD_REG_IND: return executeLoad(); // also for immediate and register-memory
+    case LD_REG: return executeLoadRegister();
+    case ST_REG_MEM: return executeStoreMemory();
+    case ST_REG_IND: return executeStore();
+    case CSRRD: return executeCsrrd();
+    case CSRWR: return executeCsrwr();
+    default: return executeIllegal();
+  }
+}
+
+void Emulator::setupHandlers(){
+
+  for(auto i = 0; i < 256; i++)
+    handlers[i] = &Emulator::executeIllegal;
+
+  // aliased operation codes (pop/ret/iret and the loads) share a handler, the operands decide
+  handlers[HALT] = &Emulator::executeHalt;
+  handlers[INT] = &Emulator::executeInt;
+  handlers[CALL] = &Emulator::executeCall;
+  handlers[BEQ] = &Emulator::executeBeq;
+  handlers[BNE] = &Emulator::executeBne;
+  handlers[BGT] = &Emulator::executeBgt;
+  handlers[JMP] = &Emulator::executeJmp;
+  handlers[PUSH] = &Emulator::executePush;
+  handlers[POP] = &Emulator::executePop;
+  handlers[ADD] = &Emulator::executeAdd;
+  handlers[SUB] = &Emulator::executeSub;
+  handlers[MUL] = &Emulator::executeMul;
+  handlers[DIV] = &Emulator::executeDiv;
+  handlers[AND] = &Emulator::executeAnd;
+  handlers[OR] = &Emulator::executeOr;
+  handlers[XOR] = &Emulator::executeXor;
+  handlers[SHL] = &Emulator::executeShl;
+  handlers[SHR] = &Emulator::executeShr;
+  handlers[XCHG] = &Emulator::executeXchg;
+  handlers[NOT] = &Emulator::executeNot;
+  handlers[LD_REG_IND] = &Emulator::executeLoad;
+  handlers[LD_REG] = &Emulator::executeLoadRegister;
+  handlers[ST_REG_MEM] = &Emulator::executeStoreMemory;
+  handlers[ST_REG_IND] = &Emulator::executeStore;
+  handlers[CSRRD] = &Emulator::executeCsrrd;
+  handlers[CSRWR] = &Emulator::executeCsrwr;
+}
+
+bool Emulator::executeHalt(){
+
+  running = false;
+  return true;
+}
+
+bool Emulator::executeInt(){
+
+  // interruption of this kind is synchronously called
+  // status<=status&(~0x1); pc<=handle;
+  csrCause = software_interrupt;
+  processSubroutine();
+  return true;
+}
+
+bool Emulator::executeCall(){
+
+  push(regPC);
+  regPC = readMemWord(regPC + displacement);
+  return true;    
+}
+
+bool Emulator::executeBeq(){
+
+  if(registers[regB] == registers[regC])
+    regPC = readMemWord(registers[regA] + displacement);
+  return true;  
+}
+
+bool Emulator::executeBne(){
+
+  if(registers[regB] != registers[regC])
+    regPC = readMemWord(registers[regA] + displacement);
+  return true; 
+}
+
+bool Emulator::executeBgt(){
+
+  if(registers[regB] > registers[regC])
+    regPC = readMemWord(registers[regA] + displacement);
+  return true;  
+}
+
+bool Emulator::executeJmp(){
+
+  regPC = readMemWord(registers[regA] + displacement);
+  return true;
+}
+
+bool Emulator::executePush(){
+
+  registers[regA]+= displacement;
+  writeMemWord(registers[regC], registers[regA]);
+  return true;
+}
+
+bool Emulator::executePop(){
+
+  registers[regA] = readMemWord(registers[regB]);
+  registers[regB]+= displacement;
+  if(iret == true){
+    csrStatus = readMemWord(registers[regB]);
+    registers[regB]+= displacement;
+    iret = false;
+    csrCause = 0;
+  }
+  return true;
+}
+
+bool Emulator::executeAdd(){
+
+  registers[regA] = registers[regB] + registers[regC];
+  return true;
+}
+
+bool Emulator::executeSub(){
+
+  registers[regA] = registers[regB] - registers[regC];
+  return true;
+}
+
+bool Emulator::executeMul(){
+
+  registers[regA] = registers[regB] * registers[regC];
+  return true;
+}
+
+bool Emulator::executeDiv(){
+
+  if(registers[regC] == 0){
+    cout<<"Illegal zero divisor at "<< hex<<to_string(regPC) << "." <<endl;
+    cout<<dec;
+    handleFault();
+    return false;
+  }
+  registers[regA] = registers[regB] / registers[regC];
+  return true;
+}
+
+bool Emulator::executeAnd(){
+
+  registers[regA] = registers[regB] & registers[regC];
+  return true;
+}
+
+bool Emulator::executeOr(){
+
+  registers[regA] = registers[regB] | registers[regC];
+  return true;
+}
+
+bool Emulator::executeXor(){
+
+  registers[regA] = registers[regB] ^ registers[regC];
+  return true;
+}
+
+bool Emulator::executeShl(){
+
+  registers[regA] = registers[regB] << registers[regC];
+  return true;
+}
+
+bool Emulator::executeShr(){
+
+  registers[regA] = registers[regB] >> registers[regC];
+  return true;
+}
+
+bool Emulator::executeXchg(){
+
+  int32_t temp = registers[regB];
+  registers[regB] = registers[regC];
+  registers[regC] = temp;
+  return true;
+}
+
+bool Emulator::executeNot(){
+
+  registers[regA] = ~registers[regB];
+  return true;         
+}
+
+bool Emulator::executeLoad(){
+
+  registers[regA] = readMemWord(registers[regB]+ registers[regC] + displacement);
+  if(ldMem){
+    ldMem = false;
+    registers[regA] = readMemWord(registers[regA]);
+  }
+  return true;    
+}
+
+bool Emulator::executeLoadRegister(){
+
+  registers[regA] =registers[regB] + displacement;
+  return true;       
+}
+
+bool Emulator::executeStoreMemory(){
+
+  uint32_t address = readMemWord(registers[regA]+ registers[regB]+ displacement);
+  writeMemWord(registers[regC], address);
+  return true;      
+}
+
+bool Emulator::executeStore(){
+
+  writeMemWord(registers[regC], registers[regA]+registers[regB]+displacement);
+  return true;
+}
+
+bool Emulator::executeCsrrd(){
+
+  registers[regA] = csrRegisters[regB]; 
+  return true;   
+}
+
+bool Emulator::executeCsrwr(){
+
+  csrRegisters[regA] = registers[regB];
+  return true;
+}
+
+bool Emulator::executeIllegal(){
+
+  cout<< "Illegal operation code at "<< hex<<to_string(regPC)<<"."<< endl;
+  cout<<dec;
+  handleFault();
+  return false;
 }
 
 void Emulator::setFlag(uint8_t flag){
@@ -541,6 +1206,7 @@ void Emulator::processSubroutine(){
   push(regPC);
 
   regPC = csrHandler;
+  if(profiling) profileInterrupt();
 
   // disabling any other interrupts while processing current
   setFlag(interrupt_flag);
@@ -550,26 +1216,47 @@ void Emulator::processSubroutine(){
 
 void Emulator::timerTick(){
 
-  auto now = std::chrono::system_clock::now();
-  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
-  currentTime = ms.count();
-  
-  if (timerActive == true){
-    auto timeElapsed =currentTime - previousTime;
-    if (currentTime - previousTime >= period){
+  if (timerActive == false) return;
+
+  if (timerMode == VIRTUAL_TIMER){
+    if (executedInstructions - timerStart >= (uint64_t)period * instructionsPerMs){
       setInterupt(timer_interrupt);
-      previousTime = currentTime;
+      timerStart = executedInstructions;
     }
-  } 
+    return;
+  }
+
+  // reading the clock costs more than emulating an instruction, so it's only sampled
+  if (executedInstructions - previousSample < sampleInterval) return;
+  previousSample = executedInstructions;
+
+  currentTime = systemTime();
+  
+  if (currentTime - previousTime >= period){
+    setInterupt(timer_interrupt);
+    previousTime = currentTime;
+  }
 }
 
-void Emulator::resetTimer(uint32_t value){
+int64_t Emulator::systemTime(){
 
-  timerActive =  true;
   auto now = std::chrono::system_clock::now();
   auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
-  currentTime = ms.count();
+  return ms.count();
+}
+
+void Emulator::writeTimerConfig(int8_t value){
+
+  resetTimer(value);
+}
+
+void Emulator::resetTimer(uint32_t value){
+
+  timerActive =  true;
+  currentTime = systemTime();
   previousTime = currentTime;
+  previousSample = executedInstructions;
+  timerStart = executedInstructions;
 
   switch(value){
     case 0x0: period = 500; break;
@@ -629,15 +1316,81 @@ bool Emulator::configureTerminal(){
 
 void Emulator::resetTerminal(){
 
+  stopInput();
   restoreConfig();
 }
 
 void Emulator::readTerminal(){
 
-  char inputChar;
-  if (read(STDIN_FILENO, &inputChar, 1)){
-    writeMemWord((uint32_t)inputChar, TERM_IN);
-    setInterupt(terminal_interrupt);    
+  uint32_t tail = inputTail.load(memory_order_relaxed);
+  if (tail == inputHead.load(memory_order_acquire)) return; // nothing was typed
+
+  char inputChar = inputBuffer[tail % INPUT_BUFFER_SIZE];
+  inputTail.store(tail + 1, memory_order_release);
+
+  writeMemWord((uint32_t)inputChar, TERM_IN);
+  setInterupt(terminal_interrupt);    
+}
+
+void Emulator::writeTerminal(int8_t value){
+
+  char character = value;
+  cout<<character;
+  lastOutput = executedInstructions;
+  outputPending = true;
+
+  if(!bufferedOutput || character == '\n') flushTerminal();
+}
+
+void Emulator::flushIdleTerminal(){
+
+  if(outputPending && executedInstructions - lastOutput >= OUTPUT_IDLE_INSTRUCTIONS)
+    flushTerminal();
+}
+
+void Emulator::flushTerminal(){
+
+  cout<<flush;
+  outputPending = false;
+}
+
+void Emulator::startInput(){
+
+  inputRunning = true;
+  inputThread = thread(&Emulator::inputLoop, this);
+}
+
+void Emulator::stopInput(){
+
+  inputRunning = false;
+  if (inputThread.joinable()) inputThread.join();
+}
+
+void Emulator::inputLoop(){
+
+  struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+
+  while (inputRunning){
+    uint32_t head = inputHead.load(memory_order_relaxed);
+    uint32_t space = INPUT_BUFFER_SIZE - (head - inputTail.load(memory_order_acquire));
+
+    // when the buffer is full, characters are left to wait in the terminal
+    if (space == 0 || poll(&input, 1, INPUT_POLL_TIMEOUT) <= 0 || !(input.revents & POLLIN)){
+      if (space == 0 || input.revents & (POLLHUP | POLLERR | POLLNVAL))
+        this_thread::sleep_for(chrono::milliseconds(INPUT_POLL_TIMEOUT));
+      continue;
+    }
+
+    char characters[INPUT_BUFFER_SIZE];
+    ssize_t count = read(STDIN_FILENO, characters, space);
+    if (count <= 0){
+      this_thread::sleep_for(chrono::milliseconds(INPUT_POLL_TIMEOUT)); // end of input
+      continue;
+    }
+
+    for (ssize_t i = 0; i < count; i++)
+      inputBuffer[(head + i) % INPUT_BUFFER_SIZE] = characters[i];
+    inputHead.store(head + count, memory_order_release);
   }
 }
 
@@ -653,16 +1406,275 @@ void Emulator::generateOutput(){
   cout<<endl;
 }
 
+void Emulator::loadSymbolMap(){
+
+  profilePrefix = inputFile.substr(0, inputFile.length()-4);
+  profileSymbols.clear();
+  pcCounts.clear();
+  branchCounts.clear();
+  for(auto i = 0; i < 256; i++) opcodeCounts[i] = 0;
+  for(auto i = 0; i < 5; i++) interruptCounts[i] = 0;
+
+  string mapFile = profilePrefix + ".map";
+  ifstream mapReader(mapFile);
+  if(mapReader.fail()){
+    cout<<"Symbol map "<< mapFile<< " cannot be opened, profile is reported by address."<<endl;
+    return;
+  }
+
+  string line;
+  while(getline(mapReader, line)){
+    stringstream fields(line);
+    ProfileSymbol symbol;
+    string binding, section;
+    if(!(fields>> hex>> symbol.address>> binding>> section>> symbol.name)) continue;
+
+    // section symbols only name code that has no label of its own
+    symbol.rank = binding == "s" ? 0 : (binding == "l" ? 1 : 2);
+    profileSymbols.push_back(symbol);
+  }
+  mapReader.close();
+
+  sort(profileSymbols.begin(), profileSymbols.end(), [](const ProfileSymbol &s1, const ProfileSymbol &s2){
+    return s1.address < s2.address || (s1.address == s2.address && s1.rank < s2.rank);
+  });
+}
+
+void Emulator::profileInstruction(){
+
+  pcCounts[currentPC]++;
+  opcodeCounts[op]++;
+  callNodes[currentNode].count++;
+}
+
+void Emulator::profileControlFlow(uint32_t next){
+
+  switch(op){
+    case BEQ: case BNE: case BGT:{
+      BranchCount &branch = branchCounts[currentPC];
+      if(regPC != next) branch.taken++;
+      else branch.notTaken++;
+      break;
+    }
+    case CALL:{
+      currentNode = enterCall(regPC);
+      break;
+    }
+    case POP:{
+      // ret and iret pop pc
+      if(regA == pc && currentNode != 0) currentNode = callNodes[currentNode].parent;
+      break;
+    }
+  }
+}
+
+void Emulator::profileInterrupt(){
+
+  if(csrCause < 5) interruptCounts[csrCause]++;
+  currentNode = enterCall(regPC);
+}
+
+uint32_t Emulator::enterCall(uint32_t address){
+
+  if(callNodes.empty()){
+    callNodes.push_back({address, 0, 0, {}});
+    return 0;
+  }
+
+  map<uint32_t, uint32_t>::iterator child = callNodes[currentNode].children.find(address);
+  if(child != callNodes[currentNode].children.end()) return child->second;
+
+  uint32_t index = callNodes.size();
+  callNodes[currentNode].children[address] = index;
+  callNodes.push_back({address, currentNode, 0, {}});
+  return index;
+}
+
+string Emulator::symbolAt(uint32_t address){
+
+  vector<ProfileSymbol>::iterator symbol = upper_bound(profileSymbols.begin(), profileSymbols.end(), address,
+    [](uint32_t value, const ProfileSymbol &s){ return value < s.address; });
+
+  stringstream location;
+  if(symbol == profileSymbols.begin()){
+    location<< "0x"<< hex<< address;
+    return location.str();
+  }
+  symbol--;
+
+  location<< symbol->name;
+  if(address != symbol->address) location<< "+0x"<< hex<< address - symbol->address;
+  return location.str();
+}
+
+string Emulator::functionAt(uint32_t address){
+
+  vector<ProfileSymbol>::iterator symbol = upper_bound(profileSymbols.begin(), profileSymbols.end(), address,
+    [](uint32_t value, const ProfileSymbol &s){ return value < s.address; });
+
+  if(symbol == profileSymbols.begin()){
+    stringstream location;
+    location<< "0x"<< hex<< address;
+    return location.str();
+  }
+  return (--symbol)->name;
+}
+
+string Emulator::opcodeName(uint8_t code){
+
+  switch (code){
+    case HALT: return "halt";
+    case INT: return "int";
+    case CALL: return "call";
+    case BEQ: return "beq";
+    case BNE: return "bne";
+    case BGT: return "bgt";
+    case JMP: return "jmp";
+    case PUSH: return "push";
+    case POP: return "pop/ret/iret";
+    case ADD: return "add";
+    case SUB: return "sub";
+    case MUL: return "mul";
+    case DIV: return "div";
+    case AND: return "and";
+    case OR: return "or";
+    case XOR: return "xor";
+    case SHL: return "shl";
+    case SHR: return "shr";
+    case XCHG: return "xchg";
+    case NOT: return "not";
+    case LD_REG_IND: return "ld";
+    case LD_REG: return "ld reg";
+    case ST_REG_MEM: return "st mem";
+    case ST_REG_IND: return "st";
+    case CSRRD: return "csrrd";
+    case CSRWR: return "csrwr";
+    default: return "illegal";
+  }
+}
+
+string Emulator::callStack(uint32_t node){
+
+  string stack = functionAt(callNodes[node].address);
+  while(node != 0){
+    node = callNodes[node].parent;
+    stack = functionAt(callNodes[node].address) + ";" + stack;
+  }
+  return stack;
+}
+
+void Emulator::generateProfile(){
+
+  if(!profiling || callNodes.empty()) return;
+
+  uint64_t total = 0;
+  for(pair<const uint32_t, uint64_t> &count: pcCounts) total += count.second;
+  if(total == 0) return;
+
+  string profileFile = profilePrefix + ".profile";
+  ofstream profile(profileFile);
+
+  profile<< "Instructions executed: "<< dec<< total<< endl<< endl;
+  profile<< fixed<< setprecision(2);
+
+  // flat profile, instructions are attributed to the symbol containing them
+  map<string, uint64_t> symbolCounts;
+  for(pair<const uint32_t, uint64_t> &count: pcCounts)
+    symbolCounts[functionAt(count.first)] += count.second;
+
+  vector<pair<uint64_t, string>> flat;
+  for(pair<const string, uint64_t> &count: symbolCounts)
+    flat.push_back({count.second, count.first});
+  sort(flat.rbegin(), flat.rend());
+
+  profile<< "Flat profile:"<< endl;
+  profile<< setw(14)<< "instructions"<< setw(9)<< "%"<< "  symbol"<< endl;
+  for(pair<uint64_t, string> &entry: flat)
+    profile<< setw(14)<< entry.first<< setw(9)<< 100.0 * entry.first / total<< "  "<< entry.second<< endl;
+  profile<< endl;
+
+  vector<pair<uint64_t, uint32_t>> hotSpots;
+  for(pair<const uint32_t, uint64_t> &count: pcCounts)
+    hotSpots.push_back({count.second, count.first});
+  sort(hotSpots.rbegin(), hotSpots.rend());
+  if(hotSpots.size() > PROFILE_HOT_SPOTS) hotSpots.resize(PROFILE_HOT_SPOTS);
+
+  profile<< "Hot spots:"<< endl;
+  profile<< setw(10)<< "address"<< setw(14)<< "instructions"<< setw(9)<< "%"<< "  location"<< endl;
+  for(pair<uint64_t, uint32_t> &entry: hotSpots)
+    profile<< "  "<< hex<< setfill('0')<< setw(8)<< entry.second<< setfill(' ')<< dec
+      << setw(14)<< entry.first<< setw(9)<< 100.0 * entry.first / total<< "  "<< symbolAt(entry.second)<< endl;
+  profile<< endl;
+
+  profile<< "Operation codes:"<< endl;
+  for(auto i = 0; i < 256; i++){
+    if(opcodeCounts[i] == 0) continue;
+    profile<< "  "<< hex<< setfill('0')<< setw(2)<< i<< setfill(' ')<< dec
+      << setw(14)<< opcodeCounts[i]<< "  "<< opcodeName(i)<< endl;
+  }
+  profile<< endl;
+
+  map<uint32_t, BranchCount> branches(branchCounts.begin(), branchCounts.end());
+  profile<< "Branches:"<< endl;
+  profile<< setw(10)<< "address"<< setw(14)<< "taken"<< setw(14)<< "not taken"<< "  location"<< endl;
+  for(pair<const uint32_t, BranchCount> &branch: branches)
+    profile<< "  "<< hex<< setfill('0')<< setw(8)<< branch.first<< setfill(' ')<< dec
+      << setw(14)<< branch.second.taken<< setw(14)<< branch.second.notTaken<< "  "<< symbolAt(branch.first)<< endl;
+  profile<< endl;
+
+  profile<< "Interrupt entries:"<< endl;
+  profile<< "  timer     "<< interruptCounts[timer_interrupt]<< endl;
+  profile<< "  terminal  "<< interruptCounts[terminal_interrupt]<< endl;
+  profile<< "  software  "<< interruptCounts[software_interrupt]<< endl;
+
+  profile.close();
+
+  // collapsed stacks, one line per distinct stack, as read by flame graph tools
+  string foldedFile = profilePrefix + ".folded";
+  ofstream folded(foldedFile);
+  for(auto i = 0; i < callNodes.size(); i++){
+    if(callNodes[i].count == 0) continue;
+    folded<< callStack(i)<< " "<< callNodes[i].count<< endl;
+  }
+  folded.close();
+
+  cout<< "Profile written to "<< profileFile<< " and "<< foldedFile<< endl;
+}
+
 int main(int argc, const char *argv[]){
-   
-   if (argc != 2){
+
+    string inputFile = "";
+    vector<string> options;
+
+    for (auto i = 1; i < argc; i++){
+      string currentParam = argv[i];
+
+      if (currentParam[0] == '-'){
+        options.push_back(currentParam);
+      }
+      else if (inputFile.length() != 0){
         cout << "Only one file for execution needs to be passed to emulator." << endl;
         return -1;
+      }
+      else{
+        inputFile = currentParam;
+      }
     }
-    
-    string inputFile = argv[1];
+
+    if (inputFile.length() == 0){
+        cout << "Only one file for execution needs to be passed to emulator." << endl;
+        return -1;
+    }
+
     Emulator emulator(inputFile);
 
+    for (string option: options){
+      if (!emulator.processOption(option)){
+        cout << "Unrecognized option " << option << "." << endl;
+        return -1;
+      }
+    }
+
     if (!emulator.processInput()) return -1;
 
     if (!emulator.loadData()) return -2;
@@ -671,5 +1683,7 @@ int main(int argc, const char *argv[]){
 
     emulator.generateOutput();
 
+    emulator.generateProfile();
+
     return 0;
-}
\ No newline at end of file
+}
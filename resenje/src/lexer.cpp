@@ -0,0 +1,432 @@
+#include "../inc/lexer.hpp"
+
+
+Lexer::Lexer(string_view source) : source(source){
+
+  position = 0;
+  line = 1;
+}
+
+uint32_t Lexer::getLine(){
+
+  return line;
+}
+
+bool Lexer::isIdentifierStart(char c){
+
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool Lexer::isIdentifierPart(char c){
+
+  return isIdentifierStart(c) || (c >= '0' && c <= '9');
+}
+
+Token Lexer::makeToken(TokenKind kind, size_t start){
+
+  return {kind, source.substr(start, position - start)};
+}
+
+Token Lexer::nextToken(){
+
+  // whitespace separates tokens, comments last until the end of the line
+  while(position < source.length()){
+    char c = source[position];
+    if(c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f')
+      position++;
+    else if(c == '#'){
+      while(position < source.length() && source[position] != '\n') position++;
+    }
+    else
+      break;
+  }
+
+  size_t start = position;
+  if(position == source.length()) return makeToken(END_TOKEN, start);
+
+  char c = source[position++];
+
+  if(c == '\n'){
+    Token newline = makeToken(NEWLINE_TOKEN, start);
+    line++;
+    return newline;
+  }
+
+  if(isIdentifierStart(c)){
+    while(position < source.length() && isIdentifierPart(source[position])) position++;
+    return makeToken(IDENTIFIER_TOKEN, start);
+  }
+
+  if(c == '.' || c == '%'){
+    if(position == source.length() || !isIdentifierStart(source[position]))
+      return makeToken(INVALID_TOKEN, start);
+    while(position < source.length() && isIdentifierPart(source[position])) position++;
+    return makeToken(c == '.' ? DIRECTIVE_TOKEN : REGISTER_TOKEN, start);
+  }
+
+  if(c >= '0' && c <= '9'){
+    // the whole run of letters and digits has to form a literal
+    while(position < source.length() && isIdentifierPart(source[position])) position++;
+    string_view literal = source.substr(start, position - start);
+
+    size_t digits = 0;
+    if(literal.length() > 2 && literal[0] == '0' && (literal[1] == 'x' || literal[1] == 'X')){
+      for(digits = 2; digits < literal.length(); digits++){
+        char d = literal[digits];
+        if(!((d >= '0' && d <= '9') || (d >= 'a' && d <= 'f') || (d >= 'A' && d <= 'F'))) break;
+      }
+    }
+    else{
+      while(digits < literal.length() && literal[digits] >= '0' && literal[digits] <= '9') digits++;
+    }
+
+    return makeToken(digits == literal.length() ? NUMBER_TOKEN : INVALID_TOKEN, start);
+  }
+
+  if(c == '"'){
+    while(position < source.length() && source[position] != '"' && source[position] != '\n') position++;
+    if(position == source.length() || source[position] != '"') return makeToken(INVALID_TOKEN, start);
+    position++;
+    return makeToken(STRING_TOKEN, start);
+  }
+
+  switch(c){
+    case '$': case '[': case ']': case '+': case '-': case '*': case '/': case ',': case ':':
+      return makeToken(PUNCTUATION_TOKEN, start);
+  }
+
+  return makeToken(INVALID_TOKEN, start);
+}
+
+// operand kinds allowed for every instruction, in order of appearance
+const Parser::InstructionFormat Parser::instructionFormats[] = {
+  {"halt", HALT_MNEMONIC, 0, {}},
+  {"int", INT_MNEMONIC, 0, {}},
+  {"iret", IRET_MNEMONIC, 0, {}},
+  {"ret", RET_MNEMONIC, 0, {}},
+  {"call", CALL_MNEMONIC, 1, {LITERAL_OPERAND | SYMBOL_OPERAND}},
+  {"jmp", JMP_MNEMONIC, 1, {LITERAL_OPERAND | SYMBOL_OPERAND}},
+  {"beq", BEQ_MNEMONIC, 3, {GPR_OPERAND, GPR_OPERAND, LITERAL_OPERAND | SYMBOL_OPERAND}},
+  {"bne", BNE_MNEMONIC, 3, {GPR_OPERAND, GPR_OPERAND, LITERAL_OPERAND | SYMBOL_OPERAND}},
+  {"bgt", BGT_MNEMONIC, 3, {GPR_OPERAND, GPR_OPERAND, LITERAL_OPERAND | SYMBOL_OPERAND}},
+  {"push", PUSH_MNEMONIC, 1, {GPR_OPERAND}},
+  {"pop", POP_MNEMONIC, 1, {GPR_OPERAND}},
+  {"not", NOT_MNEMONIC, 1, {GPR_OPERAND}},
+  {"xchg", XCHG_MNEMONIC, 2, {GPR_OPERAND, GPR_OPERAND}},
+  {"add", ADD_MNEMONIC, 2, {GPR_OPERAND, GPR_OPERAND}},
+  {"sub", SUB_MNEMONIC, 2, {GPR_OPERAND, GPR_OPERAND}},
+  {"mul", MUL_MNEMONIC, 2, {GPR_OPERAND, GPR_OPERAND}},
+  {"div", DIV_MNEMONIC, 2, {GPR_OPERAND, GPR_OPERAND}},
+  {"and", AND_MNEMONIC, 2, {GPR_OPERAND, GPR_OPERAND}},
+  {"or", OR_MNEMONIC, 2, {GPR_OPERAND, GPR_OPERAND}},
+  {"xor", XOR_MNEMONIC, 2, {GPR_OPERAND, GPR_OPERAND}},
+  {"shl", SHL_MNEMONIC, 2, {GPR_OPERAND, GPR_OPERAND}},
+  {"shr", SHR_MNEMONIC, 2, {GPR_OPERAND, GPR_OPERAND}},
+  {"ld", LD_MNEMONIC, 2, {LITERAL_OPERAND | SYMBOL_OPERAND | IMMEDIATE_LITERAL | IMMEDIATE_SYMBOL
+    | GPR_OPERAND | REGISTER_INDIRECT, GPR_OPERAND}},
+  {"st", ST_MNEMONIC, 2, {GPR_OPERAND, LITERAL_OPERAND | SYMBOL_OPERAND | REGISTER_INDIRECT}},
+  {"csrrd", CSRRD_MNEMONIC, 2, {CSR_OPERAND, GPR_OPERAND}},
+  {"csrwr", CSRWR_MNEMONIC, 2, {GPR_OPERAND, CSR_OPERAND}}
+};
+
+Parser::Parser(string_view source) : lexer(source){
+
+}
+
+void Parser::parse(vector<Statement> &statements){
+
+  bool end = false;
+  while(!end){
+    tokens.clear();
+    uint32_t line = lexer.getLine();
+
+    while(true){
+      Token token = lexer.nextToken();
+      if(token.kind == END_TOKEN){
+        end = true;
+        break;
+      }
+      if(token.kind == NEWLINE_TOKEN) break;
+      tokens.push_back(token);
+    }
+
+    if(tokens.empty()) continue; // blank lines and comments
+
+    Statement statement;
+    statement.line = line;
+    parseLine(statement);
+    statements.push_back(statement);
+  }
+}
+
+void Parser::parseLine(Statement &statement){
+
+  size_t index = 0;
+
+  if(tokens.size() >= 2 && tokens[0].kind == IDENTIFIER_TOKEN && isPunctuation(1, ':')){
+    statement.label = tokens[0].text;
+    index = 2;
+  }
+
+  if(index == tokens.size()){
+    statement.kind = LABEL_STATEMENT;
+    return;
+  }
+
+  if(tokens[index].kind == DIRECTIVE_TOKEN)
+    parseDirective(statement, index);
+  else if(tokens[index].kind == IDENTIFIER_TOKEN)
+    parseInstruction(statement, index);
+  else
+    statement.kind = INVALID_STATEMENT;
+}
+
+void Parser::parseDirective(Statement &statement, size_t index){
+
+  string_view directive = tokens[index].text;
+  statement.kind = INVALID_STATEMENT;
+
+  if(directive == ".end"){
+    if(index + 1 == tokens.size()) statement.kind = END_STATEMENT;
+    return;
+  }
+
+  if(directive == ".equ"){
+    // .equ symbol, expression
+    if(index + 2 < tokens.size() && tokens[index + 1].kind == IDENTIFIER_TOKEN && isPunctuation(index + 2, ',')
+      && parseExpression(index + 3, statement.expression)){
+      statement.operands.push_back({SYMBOL_OPERAND, tokens[index + 1].text, string_view(), 0});
+      statement.kind = EQU_STATEMENT;
+    }
+    return;
+  }
+
+  if(!parseOperandList(index + 1, statement.operands) || statement.operands.empty()) return;
+
+  size_t count = statement.operands.size();
+  uint8_t allowed = 0;
+  StatementKind kind;
+
+  if(directive == ".global"){
+    kind = GLOBAL_STATEMENT;
+    allowed = SYMBOL_OPERAND;
+  }
+  else if(directive == ".extern"){
+    kind = EXTERN_STATEMENT;
+    allowed = SYMBOL_OPERAND;
+  }
+  else if(directive == ".section" && count == 1){
+    kind = SECTION_STATEMENT;
+    allowed = SYMBOL_OPERAND;
+  }
+  else if(directive == ".word"){
+    kind = WORD_STATEMENT;
+    allowed = SYMBOL_OPERAND | LITERAL_OPERAND;
+  }
+  else if(directive == ".skip" && count == 1){
+    kind = SKIP_STATEMENT;
+    allowed = LITERAL_OPERAND;
+  }
+  else if(directive == ".ascii" && count == 1){
+    kind = ASCII_STATEMENT;
+    allowed = STRING_OPERAND;
+  }
+  else
+    return;
+
+  for(Operand &operand: statement.operands)
+    if((operand.kind & allowed) == 0) return;
+
+  statement.kind = kind;
+}
+
+void Parser::parseInstruction(Statement &statement, size_t index){
+
+  string_view name = tokens[index].text;
+  statement.kind = INVALID_STATEMENT;
+
+  for(const InstructionFormat &format: instructionFormats){
+    if(name != format.name) continue;
+
+    if(!parseOperandList(index + 1, statement.operands)) return;
+    if(statement.operands.size() != format.operandCount) return;
+
+    for(auto i = 0; i < format.operandCount; i++)
+      if((statement.operands[i].kind & format.operands[i]) == 0) return;
+
+    statement.kind = INSTRUCTION_STATEMENT;
+    statement.mnemonic = format.mnemonic;
+    return;
+  }
+}
+
+bool Parser::parseOperandList(size_t index, vector<Operand> &operands){
+
+  if(index == tokens.size()) return true;
+
+  while(true){
+    Operand operand;
+    if(!parseOperand(index, operand)) return false;
+    operands.push_back(operand);
+
+    if(index == tokens.size()) return true;
+    if(!isPunctuation(index, ',')) return false;
+    index++;
+  }
+}
+
+bool Parser::parseOperand(size_t &index, Operand &operand){
+
+  if(index >= tokens.size()) return false;
+
+  Token &token = tokens[index];
+  operand.offset = string_view();
+  operand.operation = 0;
+
+  switch(token.kind){
+    case REGISTER_TOKEN:{
+      string_view name = token.text.substr(1);
+      if(isGeneralRegister(name)) operand.kind = GPR_OPERAND;
+      else if(isControlRegister(name)) operand.kind = CSR_OPERAND;
+      else return false;
+      operand.text = token.text;
+      index++;
+      return true;
+    }
+    case IDENTIFIER_TOKEN:{
+      operand.kind = SYMBOL_OPERAND;
+      operand.text = token.text;
+      index++;
+      return true;
+    }
+    case STRING_TOKEN:{
+      operand.kind = STRING_OPERAND;
+      operand.text = token.text;
+      index++;
+      return true;
+    }
+    case NUMBER_TOKEN:{
+      operand.kind = LITERAL_OPERAND;
+      return parseLiteral(index, operand.text);
+    }
+    case PUNCTUATION_TOKEN: break;
+    default: return false;
+  }
+
+  if(isPunctuation(index, '-')){
+    operand.kind = LITERAL_OPERAND;
+    return parseLiteral(index, operand.text);
+  }
+
+  // $literal or $symbol, written without a space
+  if(isPunctuation(index, '$')){
+    index++;
+    if(!isAdjacent(index)) return false;
+    if(index < tokens.size() && tokens[index].kind == IDENTIFIER_TOKEN){
+      operand.kind = IMMEDIATE_SYMBOL;
+      operand.text = tokens[index++].text;
+      return true;
+    }
+    operand.kind = IMMEDIATE_LITERAL;
+    return parseLiteral(index, operand.text);
+  }
+
+  // [%reg] or [%reg + offset], the register follows the bracket without a space
+  if(isPunctuation(index, '[')){
+    index++;
+    if(!isAdjacent(index) || tokens[index].kind != REGISTER_TOKEN
+      || !isGeneralRegister(tokens[index].text.substr(1))) return false;
+    operand.kind = REGISTER_INDIRECT;
+    operand.text = tokens[index++].text;
+
+    if(isPunctuation(index, '+')){
+      index++;
+      if(index < tokens.size() && tokens[index].kind == IDENTIFIER_TOKEN)
+        operand.offset = tokens[index++].text;
+      else if(!parseLiteral(index, operand.offset))
+        return false;
+    }
+
+    if(!isPunctuation(index, ']')) return false;
+    index++;
+    return true;
+  }
+
+  return false;
+}
+
+bool Parser::parseLiteral(size_t &index, string_view &text){
+
+  // a minus sign belongs to the literal only when it's written right next to it
+  if(isPunctuation(index, '-')){
+    if(index + 1 >= tokens.size() || tokens[index + 1].kind != NUMBER_TOKEN) return false;
+
+    if(!isAdjacent(index + 1)) return false;
+
+    string_view sign = tokens[index].text;
+    string_view number = tokens[index + 1].text;
+    string_view literal(sign.data(), number.length() + 1);
+    if(number[0] != '0' || number.length() == 1 || (number[1] != 'x' && number[1] != 'X')){
+      text = literal;
+      index += 2;
+      return true;
+    }
+    return false; // only decimal literals can be negative
+  }
+
+  if(index >= tokens.size() || tokens[index].kind != NUMBER_TOKEN) return false;
+  text = tokens[index++].text;
+  return true;
+}
+
+bool Parser::parseExpression(size_t index, vector<Operand> &expression){
+
+  char operation = 0;
+  while(true){
+    Operand term;
+    term.offset = string_view();
+    term.operation = operation;
+
+    if(index < tokens.size() && tokens[index].kind == IDENTIFIER_TOKEN){
+      term.kind = SYMBOL_OPERAND;
+      term.text = tokens[index++].text;
+    }
+    else if(parseLiteral(index, term.text)){
+      term.kind = LITERAL_OPERAND;
+    }
+    else
+      return false;
+
+    expression.push_back(term);
+    if(index == tokens.size()) return true;
+
+    if(isPunctuation(index, '+') || isPunctuation(index, '-') || isPunctuation(index, '*')
+      || isPunctuation(index, '/'))
+      operation = tokens[index++].text[0];
+    else
+      return false;
+  }
+}
+
+bool Parser::isPunctuation(size_t index, char c){
+
+  return index < tokens.size() && tokens[index].kind == PUNCTUATION_TOKEN && tokens[index].text[0] == c;
+}
+
+bool Parser::isAdjacent(size_t index){
+
+  return index > 0 && index < tokens.size()
+    && tokens[index - 1].text.data() + tokens[index - 1].text.length() == tokens[index].text.data();
+}
+
+bool Parser::isGeneralRegister(string_view name){
+
+  if(name == "sp" || name == "pc") return true;
+  if(name.length() == 2 && name[0] == 'r' && name[1] >= '0' && name[1] <= '9') return true;
+  return name.length() == 3 && name[0] == 'r' && name[1] == '1' && name[2] >= '0' && name[2] <= '5';
+}
+
+bool Parser::isControlRegister(string_view name){
+
+  return name == "status" || name == "handler" || name == "cause";
+}
@@ -4,9 +4,33 @@
 Linker::Linker(){
 
   this->relocatable = false;
+  this->fillGaps = false;
   this->outputFile = "linkerOut.o";
   this->fileEnd = false;
   this->errorDetected =  false;
+  this->threads = thread::hardware_concurrency();
+  if (this->threads == 0) this->threads = 1;
+}
+
+void Linker::parallelFor(uint32_t count, function<void(uint32_t)> task){
+
+  // workers take the next unprocessed index until all are taken
+  atomic<uint32_t> next(0);
+  auto worker = [&](){
+    for (uint32_t i = next++; i < count; i = next++){
+      task(i);
+    }
+  };
+
+  uint32_t workers = threads < count ? threads : count;
+  vector<thread> pool;
+  for (auto i = 1; i < workers; i++){
+    pool.push_back(thread(worker));
+  }
+  worker();
+  for (thread &t: pool){
+    t.join();
+  }
 }
 
 void Linker::link(){
@@ -57,6 +81,7 @@ void Linker::link(){
 
   generateExe();
   generateBinaryExe();
+  generateSymbolMap();
   cout<<"Linking successful: executable file generated."<<endl;
   
   cout<<"************"<<endl;
@@ -77,16 +102,16 @@ void Linker::printContent(){
     for (auto j = 0; j< words; j+=4){
       cout<< hex<<setw(8) << setfill('0') << (AggregatedSectionTable[i].virtualAddress+j);
 
-      cout<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[AggregatedSectionTable[i].virtualAddress+j];
-      cout<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[AggregatedSectionTable[i].virtualAddress+j+1];
-      cout<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[AggregatedSectionTable[i].virtualAddress+j+2];
-      cout<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[AggregatedSectionTable[i].virtualAddress+j+3];
+      cout<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[j];
+      cout<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[j+1];
+      cout<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[j+2];
+      cout<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[j+3];
       cout<< endl;
     }
     if(words!= AggregatedSectionTable[i].length){
       cout<< hex<<setw(8) << setfill('0') << (AggregatedSectionTable[i].base+words);
       for(auto k = 0; k<AggregatedSectionTable[i].length -words; k++  )
-        cout<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[AggregatedSectionTable[i].virtualAddress+k+words];
+        cout<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[k+words];
     }
   }
 
@@ -96,34 +121,35 @@ void Linker::printContent(){
 
 void Linker::aggregateDataTables(){
 
+  // parts of every output section, in the order of the input files
+  struct Part{ uint32_t file; uint32_t section; };
+  vector<vector<Part>> parts(AggregatedSectionTable.size());
   for(auto i = 0; i < inputFiles.size(); i++){
     for(auto j = 0; j < SectionTables[i].size() ; j++){
-      uint32_t aggregatedSection = SectionTables[i][j].aggregateIndex;
-      uint32_t vaddr = AggregatedSectionTable[SectionTables[i][j].aggregateIndex].virtualAddress;
-      vaddr+= SectionTables[i][j].base;
-      for(uint32_t k = 0; k < SectionTables[i][j].length; k++){
-        uint32_t newAddr = vaddr + k;
-        AggregatedSectionTable[aggregatedSection].data[newAddr]= SectionTables[i][j].data[k]; 
-      }
+      if(SectionTables[i][j].length != 0) parts[SectionTables[i][j].aggregateIndex].push_back({(uint32_t)i, (uint32_t)j});
     }
   }
-}
 
-bool Linker::overlapingSections(MappedSection s1, MappedSection s2){
+  // output sections don't share memory, each one is filled by a single worker
+  parallelFor(AggregatedSectionTable.size(), [&](uint32_t section){
+    SectionDefinition &aggregatedSection = AggregatedSectionTable[section];
+    aggregatedSection.data.assign(aggregatedSection.length, 0);
+    for(Part &part: parts[section]){
+      const SectionDefinition &source = SectionTables[part.file][part.section];
+      // parts of a section are laid out one after another, base is the offset of this part
+      memcpy(aggregatedSection.data.data() + source.base, fileData[part.file].data() + source.dataOffset,
+        source.length);
+    }
+  });
 
-  uint32_t endAdrr1 = s1.startAddress + s1.size;
-  uint32_t endAdrr2 = s2.startAddress + s2.size;
-  
-  if(s1.startAddress <= s2.startAddress && endAdrr1 <= s2.startAddress) return false;
-  
-  if(s1.startAddress >= s2.startAddress && s1.startAddress >= endAdrr2) return false;
-  
-  return true;
+  // everything needed from the input files is in the aggregated sections now
+  vector<vector<uint8_t>>().swap(fileData);
 }
 
 bool Linker::processInput(int numParam, const char *params[]){
 
   regex regPlace("^-place=([a-zA-Z_][a-zA-Z_0-9]*)@(0[xX][0-9a-fA-F]+)$");
+  regex regThreads("^-threads=([1-9][0-9]*)$");
   smatch placement;
 
   bool outputSet = false;
@@ -144,11 +170,17 @@ bool Linker::processInput(int numParam, const char *params[]){
     else if (currentParam == "-hex"){
       hex = true;
     }
+    else if (currentParam == "-fill-gaps"){
+      this->fillGaps = true;
+    }
     else if (regex_search(currentParam, placement, regPlace)){
       string sectionLabel = placement.str(1);
       uint32_t address = stoul(placement.str(2), nullptr, 16);
       mappedSections.push_back({sectionLabel, address, 0});
     }
+    else if (regex_search(currentParam, placement, regThreads)){
+      this->threads = stoul(placement.str(1));
+    }
     else if (outputSet){
       if (outputFile.size() != 0){
         cout<<"Error: Multiple output files set."<<endl;
@@ -198,63 +230,49 @@ void Linker::generateObj(){
   string outputBin = this->outputFile;
   
   ofstream outputFile(outputBin, ios::out | ios::binary);
-  
-  // Symbols
-  uint32_t symbols = AggregatedSymbolTable.size();
-  outputFile.write((char *)&symbols, sizeof(symbols));
-  for (auto i = 0; i< AggregatedSymbolTable.size();i++){     
-    outputFile.write((char *)(&i), sizeof(i));
-    uint32_t labelLen = AggregatedSymbolTable[i].label.length();
-
-    outputFile.write((char *)(&labelLen), sizeof(labelLen));
-    outputFile.write(AggregatedSymbolTable[i].label.c_str(), labelLen);
-
-    outputFile.write((char *)(&AggregatedSymbolTable[i].section), sizeof(AggregatedSymbolTable[i].section));
-    outputFile.write((char *)(&AggregatedSymbolTable[i].defined), sizeof(AggregatedSymbolTable[i].defined));
-    outputFile.write((char *)(&AggregatedSymbolTable[i].external), sizeof(AggregatedSymbolTable[i].external));
-    outputFile.write((char *)(&AggregatedSymbolTable[i].global), sizeof(AggregatedSymbolTable[i].global));
-    outputFile.write((char *)(&AggregatedSymbolTable[i].value), sizeof(AggregatedSymbolTable[i].value));        
-  }
-  // Sections
-  uint32_t sections = AggregatedSectionTable.size();
-  outputFile.write((char *)&sections, sizeof(sections));
 
-  for (auto i = 0; i< AggregatedSectionTable.size(); i++){
-    outputFile.write((char *)(&i), sizeof(i));
+  // names of symbols and sections are kept in the string table
+  string stringTable;
 
-    uint32_t labelLen = AggregatedSectionTable[i].name.length();
-    outputFile.write((char *)(&labelLen), sizeof(labelLen));
-    outputFile.write(AggregatedSectionTable[i].name.c_str(), labelLen);
+  vector<ObjSymbol> symbols;
+  for (const SymbolDefinition &symbol: AggregatedSymbolTable){
+    symbols.push_back({(uint32_t)stringTable.size(), symbol.section, symbol.value,
+      symbol.global, symbol.external, symbol.defined, 0});
+    stringTable.append(symbol.label);
+    stringTable.push_back('\0');
+  }
 
-    outputFile.write((char *)(&AggregatedSectionTable[i].base), sizeof(AggregatedSectionTable[i].base));
-    outputFile.write((char *)(&AggregatedSectionTable[i].length), sizeof(AggregatedSectionTable[i].length));
+  vector<ObjSection> sections;
+  for (const SectionDefinition &section: AggregatedSectionTable){
+    sections.push_back({(uint32_t)stringTable.size(), section.base, section.length});
+    stringTable.append(section.name);
+    stringTable.push_back('\0');
+  }
 
-    // Data output
-    uint32_t dataSize  = AggregatedSectionTable[i].length;
-    outputFile.write((char *)&dataSize, sizeof(dataSize));
-    for (auto j = 0; j< AggregatedSectionTable[i].length; j++){
-      uint32_t adr0 = AggregatedSectionTable[i].base + j;
-      outputFile.write((char *)(&adr0), sizeof(adr0));
-      
-      int8_t value = AggregatedSectionTable[i].data[AggregatedSectionTable[i].base+j]; 
-      outputFile.write((char *)(&value), sizeof(value));
-    }         
-  }      
+  vector<ObjRelocation> relocations;
+  for (const RelocationDefinition &reloc: AggregatedRelocationTable){
+    relocations.push_back({reloc.section, reloc.offset, reloc.symbolIndex, reloc.addend, R_X86_64_32_TYPE});
+  }
 
-    // Relocations 
-  uint32_t relocs = AggregatedRelocationTable.size();
-  
-  outputFile.write((char *)&relocs, sizeof(relocs));
-  for (auto i = 0; i< AggregatedRelocationTable.size();i++){  
-    outputFile.write((char *)(&i), sizeof(i));   
-    outputFile.write((char *)(&AggregatedRelocationTable[i].addend), sizeof(AggregatedRelocationTable[i].addend));
-    outputFile.write((char *)(&AggregatedRelocationTable[i].offset), sizeof(AggregatedRelocationTable[i].offset));
-    outputFile.write((char *)(&AggregatedRelocationTable[i].section), sizeof(AggregatedRelocationTable[i].section));
-    outputFile.write((char *)(&AggregatedRelocationTable[i].symbolIndex), sizeof(AggregatedRelocationTable[i].symbolIndex));
+  ObjHeader header;
+  memcpy(header.magic, OBJ_MAGIC, sizeof(header.magic));
+  header.version = OBJ_VERSION;
+  header.symbols = symbols.size();
+  header.sections = sections.size();
+  header.relocations = relocations.size();
+  header.stringTableSize = stringTable.size();
+
+  outputFile.write((char *)&header, sizeof(header));
+  outputFile.write(stringTable.data(), stringTable.size());
+  outputFile.write((char *)symbols.data(), symbols.size() * sizeof(ObjSymbol));
+  outputFile.write((char *)sections.data(), sections.size() * sizeof(ObjSection));
+  for (const SectionDefinition &section: AggregatedSectionTable){
+    outputFile.write((char *)section.data.data(), section.length);
   }
+  outputFile.write((char *)relocations.data(), relocations.size() * sizeof(ObjRelocation));
 
-    outputFile.close();
-    cout<<"Binary generated in "<<outputBin<<endl;
+  outputFile.close();
+  cout<<"Binary generated in "<<outputBin<<endl;
 }
 void Linker::generateExe(){
   
@@ -264,7 +282,7 @@ void Linker::generateExe(){
 
   // Data output for absolute section
  
-  for(SectionDefinition section: AggregatedSectionTable){
+  for(const SectionDefinition &section: AggregatedSectionTable){
     // Data output
     if (section.length == 0) continue;
     hexTXT<<"< "<<section.name<<" >"<<endl;
@@ -272,22 +290,24 @@ void Linker::generateExe(){
     uint32_t adr;
     for(auto i = 0; i < cnt; i+= 8){
       uint32_t adr=section.virtualAddress+i;
+      const uint8_t *bytes = section.data.data() + i;
       hexTXT<< hex<<setfill('0') << setw(8)<< adr<< "\t";
-      hexTXT<< hex<<setfill('0') << setw(2)<< +section.data[adr+0]<< "\t"<< hex<<setfill('0') << setw(2)<< +section.data[adr+1]
-      << "\t"<< hex<<setfill('0') << setw(2)<< +section.data[adr+2]<< "\t"<< hex<<setfill('0') << setw(2)
-      << +section.data[adr+3]<< "\t"<< hex<<setfill('0') << setw(2)<< +section.data[adr+4]
-        << "\t"<< hex<<setfill('0') << setw(2)<< +section.data[adr+5]<< "\t"
-        << hex<<setfill('0') << setw(2)<< +section.data[adr+6]<< "\t"
-        << hex<<setfill('0') << setw(2)<< +section.data[adr+7];
+      hexTXT<< hex<<setfill('0') << setw(2)<< +bytes[0]<< "\t"<< hex<<setfill('0') << setw(2)<< +bytes[1]
+      << "\t"<< hex<<setfill('0') << setw(2)<< +bytes[2]<< "\t"<< hex<<setfill('0') << setw(2)
+      << +bytes[3]<< "\t"<< hex<<setfill('0') << setw(2)<< +bytes[4]
+        << "\t"<< hex<<setfill('0') << setw(2)<< +bytes[5]<< "\t"
+        << hex<<setfill('0') << setw(2)<< +bytes[6]<< "\t"
+        << hex<<setfill('0') << setw(2)<< +bytes[7];
 
       hexTXT<< endl;
     }  
     int32_t cnt1 = section.length % 8;
     adr =section.length-cnt1 + section.virtualAddress;
+    const uint8_t *bytes = section.data.data() + section.length - cnt1;
     hexTXT<< hex<<setfill('0') << setw(8)<< adr<< "\t";
     for(auto i = 0; i< 8; i++){
       if(i<cnt1)
-        hexTXT<< hex<<setfill('0') << setw(2)<< +section.data[adr+0]<< "\t";
+        hexTXT<< hex<<setfill('0') << setw(2)<< +bytes[0]<< "\t";
       else
         hexTXT<< hex<<setfill('0') << setw(2)<< +0<< "\t";     
     }
@@ -299,6 +319,28 @@ void Linker::generateExe(){
   cout<<"Text generated in "<< outputTXT<<endl; 
 }
 
+void Linker::generateSymbolMap(){
+
+  string outputMap = outputFile.substr(0, outputFile.length()-3);
+  outputMap+="map";
+  ofstream symbolMap(outputMap);
+
+  // address, binding (g - global, l - local, s - section) and section of every defined symbol
+  for(const SymbolDefinition &symbol: AggregatedSymbolTable){
+    if(!symbol.defined || symbol.section == AbsoluteSectionIndex || symbol.section == UndefinedSectionIndex)
+      continue;
+
+    const string &sectionName = AggregatedSectionTable[symbol.section].name;
+    char binding = symbol.label == sectionName ? 's' : (symbol.global ? 'g' : 'l');
+    symbolMap<< hex<<setfill('0') << setw(8)<< (uint32_t)symbol.value<< "\t"<< binding<< "\t"
+      << sectionName<< "\t"<< symbol.label<< endl;
+  }
+  symbolMap<< dec;
+
+  symbolMap.close();
+  cout<<"Symbol map generated in "<< outputMap<<endl; 
+}
+
 void Linker::generateBinaryExe(){
 
   ofstream bin(this->outputFile, ios::out | ios::binary);
@@ -308,7 +350,7 @@ void Linker::generateBinaryExe(){
   bin.write((char *)&sections, sizeof(sections));
 
   // Data output for absolute section
-  for(SectionDefinition section: AggregatedSectionTable){
+  for(const SectionDefinition &section: AggregatedSectionTable){
     // Data output   
     uint32_t dataSize = section.length;
     uint32_t vaddr = section.virtualAddress;
@@ -316,13 +358,7 @@ void Linker::generateBinaryExe(){
     bin.write((char *)(&vaddr), sizeof(vaddr));
     bin.write((char *)(&dataSize), sizeof(dataSize));
 
-    uint32_t addr;
-    for(auto i = 0; i < section.length; i++){
-      uint32_t addr=section.virtualAddress+i;
-      int8_t val = section.data[addr] & 0xff;
-      
-      bin.write((char *)(&val), sizeof(val));
-    }    
+    bin.write((char *)section.data.data(), section.length);
   }
   
   bin.close();
@@ -375,7 +411,7 @@ void Linker::generateObjTxt(){
   for (auto i= 0; i< AggregatedSectionTable.size(); i++){    
     ObjTXT<< "Relocation data<"<< AggregatedSectionTable[i].name<< ">:"<< endl;
     ObjTXT << "Offset\tType\tSymbol\tAddend" << endl;
-    for (RelocationDefinition reloc : AggregatedRelocationTable){
+    for (const RelocationDefinition &reloc : AggregatedRelocationTable){
       if (reloc.section == i){
         ObjTXT<< hex<< setfill('0')<< setw(8) 
           << reloc.offset<< "\t" <<reloc.type<< "\t" << AggregatedSymbolTable[reloc.symbolIndex].label
@@ -392,16 +428,16 @@ void Linker::generateObjTxt(){
     for (auto j = 0; j< words; j+=4){
       ObjTXT<< hex<<setw(8) << setfill('0') << (AggregatedSectionTable[i].base+j);
       
-      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[AggregatedSectionTable[i].base+j];
-      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[AggregatedSectionTable[i].base+j+1];
-      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[AggregatedSectionTable[i].base+j+2];
-      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[AggregatedSectionTable[i].base+j+3];
+      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[j];
+      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[j+1];
+      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[j+2];
+      ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[j+3];
       ObjTXT<< endl;
     }
     if(words!= AggregatedSectionTable[i].length){
       ObjTXT<< hex<<setw(8) << setfill('0') << (AggregatedSectionTable[i].base+words);
       for(auto k = 0; k<AggregatedSectionTable[i].length -words; k++  )
-        ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[AggregatedSectionTable[i].base+k+words];
+        ObjTXT<< hex<<"\t"<<setw(2) << setfill('0')<< +AggregatedSectionTable[i].data[k+words];
     }
      
     ObjTXT << dec; 
@@ -416,170 +452,299 @@ void Linker::generateObjTxt(){
     
 bool Linker::processInputFiles(){
 
+  // tables of each file have their own slot, so files can be read in any order
+  SymbolTables.assign(inputFiles.size(), vector<SymbolDefinition>());
+  SectionTables.assign(inputFiles.size(), vector<SectionDefinition>());
+  RelocationTables.assign(inputFiles.size(), vector<RelocationDefinition>());
+  fileData.assign(inputFiles.size(), vector<uint8_t>());
+  vector<uint8_t> valid(inputFiles.size(), false);
+
+  parallelFor(inputFiles.size(), [&](uint32_t file){
+    valid[file] = readInputFile(file);
+  });
+
+  // errors are reported in the order of the files on the command line
   for (auto i = 0; i < inputFiles.size(); i++){
-    ifstream inputFile(inputFiles[i], ios::binary);
-    if (inputFile.fail()){
+    if (!valid[i]){
       errorDetected = true;
-      cout << "Failed to read input file " << inputFiles[i] << "." << endl;
+      if (ifstream(inputFiles[i], ios::binary).fail())
+        cout << "Failed to read input file " << inputFiles[i] << "." << endl;
+      else
+        cout << "Input file " << inputFiles[i] << " is not a valid object file." << endl;
       return false;
     }
-    vector<SymbolDefinition> fileSymbolTable;
-    uint32_t symbols = 0;
-    inputFile.read((char *)&symbols, sizeof(symbols));
+  }
 
-    for (auto i = 0; i < symbols; i++){
-      SymbolDefinition readSymbol;
+  return true;
+}
 
-      uint32_t index;
-      inputFile.read((char *)(&index), sizeof(index)); // redundant
-      
-      uint32_t stringLength;
-      inputFile.read((char *)(&stringLength), sizeof(stringLength));
-      readSymbol.label.resize(stringLength);
-      inputFile.read((char *)readSymbol.label.c_str(), stringLength);
+bool Linker::readInputFile(uint32_t file){
 
-      inputFile.read((char *)(&readSymbol.section), sizeof(readSymbol.section));
-      inputFile.read((char *)(&readSymbol.defined), sizeof(readSymbol.defined));
-      inputFile.read((char *)(&readSymbol.external), sizeof(readSymbol.external));
-      inputFile.read((char *)(&readSymbol.global), sizeof(readSymbol.global));
-      inputFile.read((char *)(&readSymbol.value), sizeof(readSymbol.value));
+  ifstream inputFile(inputFiles[file], ios::binary);
+  if (inputFile.fail()) return false;
 
-      fileSymbolTable.push_back(readSymbol);
-    }
+  char magic[sizeof(OBJ_MAGIC)];
+  inputFile.read(magic, sizeof(magic));
+  if (inputFile.gcount() == sizeof(magic) && memcmp(magic, OBJ_MAGIC, sizeof(magic)) == 0){
+    return readObjectFile(inputFile, file);
+  }
 
-    SymbolTables.push_back(fileSymbolTable);
+  inputFile.clear();
+  inputFile.seekg(0);
+  return readLegacyObjectFile(inputFile, file);
+}
 
-    vector<SectionDefinition> fileSectionTable;
-    uint32_t sections = 0;
-    inputFile.read((char *)&sections, sizeof(sections));
+bool Linker::readObjectFile(ifstream &inputFile, uint32_t file){
+
+  // every part of the file is read with a single read, section data straight into fileData
+  inputFile.seekg(0, ios::end);
+  size_t fileSize = inputFile.tellg();
+  inputFile.seekg(0);
+
+  ObjHeader header;
+  inputFile.read((char *)&header, sizeof(header));
+  if (inputFile.fail() || header.version != OBJ_VERSION) return false;
+
+  size_t symbolsStart = header.stringTableSize;
+  size_t sectionsStart = symbolsStart + (size_t)header.symbols * sizeof(ObjSymbol);
+  size_t recordsSize = sectionsStart + (size_t)header.sections * sizeof(ObjSection);
+  if (sizeof(ObjHeader) + recordsSize > fileSize) return false;
+
+  vector<char> records(recordsSize);
+  inputFile.read(records.data(), recordsSize);
+  if (inputFile.fail()) return false;
+  if (header.stringTableSize != 0 && records[symbolsStart - 1] != '\0') return false;
+
+  const char *strings = records.data();
+
+  vector<SymbolDefinition> fileSymbolTable(header.symbols);
+  for (auto i = 0; i < header.symbols; i++){
+    ObjSymbol record;
+    memcpy(&record, records.data() + symbolsStart + i * sizeof(ObjSymbol), sizeof(record));
+    if (record.name >= header.stringTableSize || record.section >= header.sections) return false;
+
+    fileSymbolTable[i].label = strings + record.name;
+    fileSymbolTable[i].section = record.section;
+    fileSymbolTable[i].value = record.value;
+    fileSymbolTable[i].global = record.global;
+    fileSymbolTable[i].external = record.external;
+    fileSymbolTable[i].defined = record.defined;
+  }
 
-    for (auto i = 0; i < sections; i++){
-      struct SectionDefinition readSection;
+  vector<SectionDefinition> fileSectionTable(header.sections);
+  size_t dataSize = 0;
+  for (auto i = 0; i < header.sections; i++){
+    ObjSection record;
+    memcpy(&record, records.data() + sectionsStart + i * sizeof(ObjSection), sizeof(record));
+    if (record.name >= header.stringTableSize) return false;
+
+    fileSectionTable[i].name = strings + record.name;
+    fileSectionTable[i].base = record.base;
+    fileSectionTable[i].length = record.length;
+    fileSectionTable[i].virtualAddress = 0;
+    fileSectionTable[i].dataOffset = dataSize;
+    dataSize += record.length;
+  }
 
-      uint32_t index;
-      inputFile.read((char *)(&index), sizeof(index)); // redundant
-      
-      uint32_t stringLength;
-      inputFile.read((char *)(&stringLength), sizeof(stringLength));
-      readSection.name.resize(stringLength);
-      inputFile.read((char *)readSection.name.c_str(), stringLength);
+  if (sizeof(ObjHeader) + recordsSize + dataSize + (size_t)header.relocations * sizeof(ObjRelocation) > fileSize)
+    return false;
 
-      inputFile.read((char *)(&readSection.base), sizeof(readSection.base));
-      inputFile.read((char *)(&readSection.length), sizeof(readSection.length));
+  fileData[file].resize(dataSize);
+  inputFile.read((char *)fileData[file].data(), dataSize);
 
-      readSection.virtualAddress = 0;
+  vector<ObjRelocation> relocations(header.relocations);
+  inputFile.read((char *)relocations.data(), relocations.size() * sizeof(ObjRelocation));
+  if (inputFile.fail()) return false;
 
-      uint32_t dataSize;
-      inputFile.read((char *)(&dataSize), sizeof(dataSize));
+  vector<RelocationDefinition> relocTab(header.relocations);
+  for (auto i = 0; i < header.relocations; i++){
+    if (relocations[i].type != R_X86_64_32_TYPE || relocations[i].section >= header.sections
+      || relocations[i].symbolIndex >= header.symbols) return false;
 
-      for (auto j = 0; j < dataSize; j++){
-        uint32_t adr;
-        inputFile.read((char *)(&adr), sizeof(adr));
+    relocTab[i].section = relocations[i].section;
+    relocTab[i].offset = relocations[i].offset;
+    relocTab[i].symbolIndex = relocations[i].symbolIndex;
+    relocTab[i].addend = relocations[i].addend;
+    relocTab[i].type = "R_X86_64_32";
+  }
 
-        int8_t val;
-        inputFile.read((char *)(&val), sizeof(val));
+  SymbolTables[file] = move(fileSymbolTable);
+  SectionTables[file] = move(fileSectionTable);
+  RelocationTables[file] = move(relocTab);
 
-        readSection.data[adr] = val;
-      }
-      fileSectionTable.push_back(readSection);
-    }
+  return true;
+}
+
+bool Linker::readLegacyObjectFile(ifstream &inputFile, uint32_t file){
 
-    SectionTables.push_back(fileSectionTable);
+  // no name can be longer than the file, reading stops at the first failed read
+  inputFile.seekg(0, ios::end);
+  size_t fileSize = inputFile.tellg();
+  inputFile.seekg(0);
 
-    int relocs = 0;
-    inputFile.read((char *)&relocs, sizeof(relocs));
+  vector<SymbolDefinition> fileSymbolTable;
+  uint32_t symbols = 0;
+  inputFile.read((char *)&symbols, sizeof(symbols));
 
-    RelocationDefinition reloc;
-    vector<RelocationDefinition> relocTab;
+  for (auto i = 0; i < symbols; i++){
+    SymbolDefinition readSymbol;
+
+    uint32_t index;
+    inputFile.read((char *)(&index), sizeof(index)); // redundant
     
-    for (auto i = 0; i < relocs; i++){
-      inputFile.read((char *)(&i), sizeof(i));
-      inputFile.read((char *)(&reloc.addend), sizeof(reloc.addend));
-      inputFile.read((char *)(&reloc.offset), sizeof(reloc.offset));
-      inputFile.read((char *)(&reloc.section), sizeof(reloc.section));
-      inputFile.read((char *)(&reloc.symbolIndex), sizeof(reloc.symbolIndex));
+    uint32_t stringLength;
+    inputFile.read((char *)(&stringLength), sizeof(stringLength));
+    if (inputFile.fail() || stringLength > fileSize) return false;
+    readSymbol.label.resize(stringLength);
+    inputFile.read((char *)readSymbol.label.c_str(), stringLength);
+
+    inputFile.read((char *)(&readSymbol.section), sizeof(readSymbol.section));
+    inputFile.read((char *)(&readSymbol.defined), sizeof(readSymbol.defined));
+    inputFile.read((char *)(&readSymbol.external), sizeof(readSymbol.external));
+    inputFile.read((char *)(&readSymbol.global), sizeof(readSymbol.global));
+    inputFile.read((char *)(&readSymbol.value), sizeof(readSymbol.value));
+    if (inputFile.fail()) return false;
+
+    fileSymbolTable.push_back(move(readSymbol));
+  }
 
-      relocTab.push_back(reloc);   
-    }
+  SymbolTables[file] = move(fileSymbolTable);
+
+  vector<SectionDefinition> fileSectionTable;
+  uint32_t sections = 0;
+  inputFile.read((char *)&sections, sizeof(sections));
+
+  for (auto i = 0; i < sections; i++){
+    struct SectionDefinition readSection;
+
+    uint32_t index;
+    inputFile.read((char *)(&index), sizeof(index)); // redundant
     
-    RelocationTables.push_back(relocTab);
+    uint32_t stringLength;
+    inputFile.read((char *)(&stringLength), sizeof(stringLength));
+    if (inputFile.fail() || stringLength > fileSize) return false;
+    readSection.name.resize(stringLength);
+    inputFile.read((char *)readSection.name.c_str(), stringLength);
+
+    inputFile.read((char *)(&readSection.base), sizeof(readSection.base));
+    inputFile.read((char *)(&readSection.length), sizeof(readSection.length));
+
+    readSection.virtualAddress = 0;
+
+    uint32_t dataSize;
+    inputFile.read((char *)(&dataSize), sizeof(dataSize));
+    if (inputFile.fail() || readSection.length > fileSize) return false;
+
+    // bytes missing from the file are zero
+    vector<uint8_t> &data = fileData[file];
+    readSection.dataOffset = data.size();
+    data.resize(data.size() + readSection.length, 0);
+    for (auto j = 0; j < dataSize; j++){
+      uint32_t adr;
+      inputFile.read((char *)(&adr), sizeof(adr));
+
+      int8_t val;
+      inputFile.read((char *)(&val), sizeof(val));
+      if (inputFile.fail()) return false;
+
+      if(adr - readSection.base < readSection.length) data[readSection.dataOffset + adr - readSection.base] = val;
+    }
+    fileSectionTable.push_back(move(readSection));
+  }
+
+  SectionTables[file] = move(fileSectionTable);
+
+  int relocs = 0;
+  inputFile.read((char *)&relocs, sizeof(relocs));
+
+  RelocationDefinition reloc;
+  reloc.type = "R_X86_64_32"; // the only type, not stored in this format
+  vector<RelocationDefinition> relocTab;
+  
+  for (auto i = 0; i < relocs; i++){
+    inputFile.read((char *)(&i), sizeof(i));
+    inputFile.read((char *)(&reloc.addend), sizeof(reloc.addend));
+    inputFile.read((char *)(&reloc.offset), sizeof(reloc.offset));
+    inputFile.read((char *)(&reloc.section), sizeof(reloc.section));
+    inputFile.read((char *)(&reloc.symbolIndex), sizeof(reloc.symbolIndex));
+    if (inputFile.fail()) return false;
+
+    if (reloc.section >= SectionTables[file].size() || reloc.symbolIndex >= SymbolTables[file].size()) return false;
 
-    inputFile.close();
+    relocTab.push_back(reloc);   
   }
 
-  return true;
+  // sections are read after symbols, so symbols are checked once the sections are known
+  for (const SymbolDefinition &symbol: SymbolTables[file])
+    if (symbol.section >= SectionTables[file].size()) return false;
+  
+  RelocationTables[file] = move(relocTab);
+
+  return !inputFile.fail();
 }
 
 void Linker::aggregateSymbolTables(){
 
-  uint32_t ai = 0;
-  
+  // symbols are combined in the order of their first appearance, files in command line order
   for(auto i =0; i< SymbolTables.size(); i++){
     for(auto j = 0; j< SymbolTables[i].size(); j++){
-      if (extractedSymbols.find(SymbolTables[i][j].label) == extractedSymbols.end()){
-        SymbolTables[i][j].aggregatedIndex = ai++;
-        extractedSymbols[SymbolTables[i][j].label] = SymbolTables[i][j];
-        extractedSymbols[SymbolTables[i][j].label].section
-           = SectionTables[i][SymbolTables[i][j].section].aggregateIndex;
+      SymbolDefinition &symbol = SymbolTables[i][j];
+      SymbolDefinition combined = symbol;
+      combined.section = SectionTables[i][symbol.section].aggregateIndex;
+      combined.aggregatedIndex = AggregatedSymbolTable.size();
+
+      bool shared = symbol.global || symbol.label == "UND" || symbol.label == "ABS"
+        || symbol.label == SectionTables[i][symbol.section].name;
+      if(!shared){
+        // two local symbols of the same name can exist in different files
+        symbol.aggregatedIndex = combined.aggregatedIndex;
+        AggregatedSymbolTable.push_back(move(combined));
+        continue;
       }
-      else{
-        if (extractedSymbols[SymbolTables[i][j].label].global 
-        && SymbolTables[i][j].global
-        && SymbolTables[i][j].defined
-        && extractedSymbols[SymbolTables[i][j].label].defined){
-          // multiple strong symbols result in error
-          errorDetected = true;
-          cout<<"Multiple defintions of symbol "<< SymbolTables[i][j].label << "."<<endl;
-          return;
-        }
-        else if(SymbolTables[i][j].defined && extractedSymbols[SymbolTables[i][j].label].global 
-        && SymbolTables[i][j].global) {
-          // if both symbols are strong, the one that is defined is chosen
-            SymbolTables[i][j].aggregatedIndex = extractedSymbols[SymbolTables[i][j].label].aggregatedIndex;
-            extractedSymbols[SymbolTables[i][j].label].section 
-              = SectionTables[i][SymbolTables[i][j].section].aggregateIndex;
-        }
-        else if(!SymbolTables[i][j].global && !extractedSymbols[SymbolTables[i][j].label].global 
-          && SymbolTables[i][j].label != "UND" && SymbolTables[i][j].label != "ABS"
-          && SymbolTables[i][j].label != SectionTables[i][SymbolTables[i][j].section].name){
-        // two local symbols of the same name can exist, they will just be labeled distinctively
-          SymbolTables[i][j].aggregatedIndex = ai++;
-          extractedSymbols[SymbolTables[i][j].label+to_string(ai)]
-            = SymbolTables[i][j];
-        }
-        else{
-          SymbolTables[i][j].aggregatedIndex = extractedSymbols[SymbolTables[i][j].label].aggregatedIndex;
-        }
-
-        extractedSymbols[SymbolTables[i][j].label].global|= SymbolTables[i][j].global;
-        extractedSymbols[SymbolTables[i][j].label].defined|= SymbolTables[i][j].defined;
-        extractedSymbols[SymbolTables[i][j].label].external|= SymbolTables[i][j].external;
-        if (SymbolTables[i][j].defined)
-          extractedSymbols[SymbolTables[i][j].label].value= SymbolTables[i][j].value;
+
+      string_view label = *symbolLabels.insert(symbol.label).first;
+      pair<unordered_map<string_view, uint32_t>::iterator, bool> entry =
+        globalSymbols.emplace(label, combined.aggregatedIndex);
+      symbol.aggregatedIndex = entry.first->second;
+      if(entry.second){
+        AggregatedSymbolTable.push_back(move(combined));
+        continue;
       }
+
+      SymbolDefinition &existing = AggregatedSymbolTable[entry.first->second];
+      if (existing.global && symbol.global && existing.defined && symbol.defined){
+        // multiple strong symbols result in error
+        errorDetected = true;
+        cout<<"Multiple defintions of symbol "<< symbol.label << "."<<endl;
+        return;
+      }
+      // the definition decides where the symbol is
+      if (symbol.defined){
+        existing.section = combined.section;
+        existing.value = symbol.value;
+      }
+      existing.global|= symbol.global;
+      existing.defined|= symbol.defined;
+      existing.external|= symbol.external;
     }
   }
 
-  uint32_t ind  = 0;
-  for(map<string, SymbolDefinition>::iterator it= extractedSymbols.begin(); it!= extractedSymbols.end(); it++){
-    if(!it->second.defined && it->second.external && !relocatable){ 
+  for(SymbolDefinition &symbol: AggregatedSymbolTable){
+    if(!symbol.defined && symbol.external && !relocatable){ 
       // any externally used symbol must be defined
-      cout<<"External symbol "<< it->first << " undefined." << endl;
+      cout<<"External symbol "<< symbol.label << " undefined." << endl;
         errorDetected = true;
         return;
     }
-    it->second.aggregatedIndex = ind++;
-    AggregatedSymbolTable.push_back(it->second);
-    if(it->second.section != AbsoluteSectionIndex)
-        AggregatedSymbolTable.back().value += AggregatedSectionTable[it->second.section].virtualAddress;
-    it->second.value = AggregatedSymbolTable.back().value;
+    if(symbol.section != AbsoluteSectionIndex)
+        symbol.value += AggregatedSectionTable[symbol.section].virtualAddress;
   }
   
   cout<<"***********"<<endl;
   cout<<"Combined Symbol Table"<<endl;
   cout<<endl;
   uint32_t k = 0;
-  for(SymbolDefinition symbol:AggregatedSymbolTable){
+  for(const SymbolDefinition &symbol: AggregatedSymbolTable){
     k++;
     cout<<"symbol: "<<symbol.label;
     cout<<"\tsection: "<<AggregatedSectionTable[symbol.section].name;
@@ -604,9 +769,9 @@ void Linker::aggregateRelocationTables(){
 
   for(auto i = 0; i< inputFiles.size(); i++){
     for(auto j = 0; j< RelocationTables[i].size(); j++){
-      SectionDefinition relocSection = SectionTables[i][RelocationTables[i][j].section];
-      SymbolDefinition relocSymbol = 
-        extractedSymbols[SymbolTables[i][RelocationTables[i][j].symbolIndex].label];
+      const SectionDefinition &relocSection = SectionTables[i][RelocationTables[i][j].section];
+      const SymbolDefinition &relocSymbol = 
+        AggregatedSymbolTable[SymbolTables[i][RelocationTables[i][j].symbolIndex].aggregatedIndex];
   
       int32_t addend = RelocationTables[i][j].addend + AggregatedSymbolTable[relocSymbol.aggregatedIndex].value;
       if(relocSection.name == relocSymbol.label) addend+= relocSection.base;
@@ -629,7 +794,7 @@ void Linker::aggregateRelocationTables(){
   cout<<"Combined Relocations"<<endl;
   cout<<endl;
  
-  for (RelocationDefinition reloc: AggregatedRelocationTable){
+  for (const RelocationDefinition &reloc: AggregatedRelocationTable){
     cout << hex<<reloc.offset;
     cout << "\t"<< reloc.type;
     cout << "\t" <<AggregatedSymbolTable[reloc.symbolIndex].label;
@@ -666,17 +831,16 @@ void Linker::aggregateSectionTables(){
 
     if (it->first == "UNDEFINED"){
       it->second.ind = 0;
-      AggregatedSectionTable.insert(AggregatedSectionTable.begin() + UndefinedSectionIndex, newSection);
+      AggregatedSectionTable.insert(AggregatedSectionTable.begin() + UndefinedSectionIndex, move(newSection));
     }
     else if (it->first == "ABSOLUTE"){
-      AggregatedSectionTable.insert(AggregatedSectionTable.begin() + 0, newSection);
+      AggregatedSectionTable.insert(AggregatedSectionTable.begin() + 0, move(newSection));
       it->second.ind =1;
     }
     else{
       it->second.ind = AggregatedSectionTable.size();
-      AggregatedSectionTable.push_back(newSection);
+      AggregatedSectionTable.push_back(move(newSection));
     }
-    newSection.aggregateIndex = it->second.ind;
   }  
     // updates value, setting virtual addresses and new section indices for sections of each file
   for(auto i = 0; i< inputFiles.size(); i++){
@@ -703,72 +867,137 @@ void Linker::aggregateSectionTables(){
 void Linker::resolveRelocations(){
   // processes the only type of relocation present in current configuration
   // r_x84_64_32
-  for(RelocationDefinition reloc: AggregatedRelocationTable){ 
-   // corrects value in memory
-    uint32_t sectionIndex = reloc.section;
-   
-    AggregatedSectionTable[sectionIndex].data[reloc.offset] = reloc.addend&0xff;
-    AggregatedSectionTable[sectionIndex].data[reloc.offset+1] = (reloc.addend>>8)&0xff;
-    AggregatedSectionTable[sectionIndex].data[reloc.offset+2] = (reloc.addend>>16)&0xff;
-    AggregatedSectionTable[sectionIndex].data[reloc.offset+3] = (reloc.addend>>24)&0xff;   
+  vector<vector<uint32_t>> sectionRelocations(AggregatedSectionTable.size());
+  for(auto i = 0; i < AggregatedRelocationTable.size(); i++){
+    sectionRelocations[AggregatedRelocationTable[i].section].push_back(i);
+  }
+  vector<uint8_t> outside(AggregatedRelocationTable.size(), false);
+
+  // relocations of one section only patch that section's buffer
+  parallelFor(AggregatedSectionTable.size(), [&](uint32_t sectionIndex){
+    SectionDefinition &section = AggregatedSectionTable[sectionIndex];
+    for(uint32_t i: sectionRelocations[sectionIndex]){
+      const RelocationDefinition &reloc = AggregatedRelocationTable[i];
+      // corrects value in memory
+      uint32_t offset = reloc.offset - section.virtualAddress;
+      if(offset >= section.length || section.length - offset < 4){
+        outside[i] = true;
+        continue;
+      }
+
+      section.data[offset] = reloc.addend&0xff;
+      section.data[offset+1] = (reloc.addend>>8)&0xff;
+      section.data[offset+2] = (reloc.addend>>16)&0xff;
+      section.data[offset+3] = (reloc.addend>>24)&0xff;   
+    }
+  });
+
+  for(auto i = 0; i < AggregatedRelocationTable.size(); i++){
+    if(!outside[i]) continue;
+    const RelocationDefinition &reloc = AggregatedRelocationTable[i];
+    cout<<"Relocation at "<< hex<< reloc.offset<< dec<< " is outside of section "
+      << AggregatedSectionTable[reloc.section].name<< "."<<endl;
+    errorDetected = true;
   }
 }
 
 void Linker::allocateSection(){
 
-  uint32_t initialFreeSpace = 0;
-
-  for(auto i = 0; i< mappedSections.size(); i++){
-    int32_t index = -1;
-    for(auto j =0; j< AggregatedSectionTable.size(); j++ ){
-      if(mappedSections[i].sectionLabel == AggregatedSectionTable[j].name){
-        index = j; // retrieved the section index for use
-        AggregatedSectionTable[j].virtualAddress = mappedSections[i].startAddress;
-        mappedSections[i].size = AggregatedSectionTable[j].length;
-        mappedSections[i].index = j;
-        cout<<dec;
-        break;
-      }
+  unordered_map<string, uint32_t> sectionIndices;
+  for(auto i = 0; i< AggregatedSectionTable.size(); i++){
+    sectionIndices.emplace(AggregatedSectionTable[i].name, i);
+  }
+
+  // memory taken by placed sections, sorted by start it only takes a look at neighbours to find overlaps
+  struct Interval{ uint64_t start; uint64_t end; uint32_t section; };
+  vector<Interval> placed;
+  vector<uint8_t> isPlaced(AggregatedSectionTable.size(), false);
+
+  for(MappedSection &mapped: mappedSections){
+    unordered_map<string, uint32_t>::iterator section = sectionIndices.find(mapped.sectionLabel);
+    if(section == sectionIndices.end()){
+      cout<<"Placed section "<< mapped.sectionLabel<< " is not defined in any input file."<<endl;
+      continue;
+    }
+    if(isPlaced[section->second]){
+      errorDetected = true;
+      cout<<"Section "<< mapped.sectionLabel<< " is placed more than once."<<endl;
+      return;
+    }
+    isPlaced[section->second] = true;
+    mapped.index = section->second;
+    mapped.size = AggregatedSectionTable[mapped.index].length;
+    AggregatedSectionTable[mapped.index].virtualAddress = mapped.startAddress;
+    if(mapped.size != 0) placed.push_back({mapped.startAddress, (uint64_t)mapped.startAddress + mapped.size, mapped.index});
+  }
+
+  sort(placed.begin(), placed.end(), [](const Interval &i1, const Interval &i2){
+    return i1.start < i2.start;
+  });
+  for(auto i = 0; i < placed.size(); i++){
+    if(placed[i].end > (uint64_t)UINT32_MAX + 1){
+      errorDetected = true;
+      cout<<"Placed section "<< AggregatedSectionTable[placed[i].section].name<< " exceeds the address space."<<endl;
+      return;
+    }
+    if(i > 0 && placed[i].start < placed[i-1].end){
+      errorDetected = true;
+      cout<<"Placed sections " << AggregatedSectionTable[placed[i-1].section].name << " and " << 
+        AggregatedSectionTable[placed[i].section].name << " are overlapping." << endl;
+      return;
     }
-    // iterating thru files 
-    uint32_t offset=0;
-      for(auto k = 0; k < SectionTables.size(); k++){
-        // iterating thru sections of a file
-        for(auto l = 0; l< SectionTables[k].size(); l++){
-          // offsetting section address with the start of aggregated section
-          if(SectionTables[k][l].name == mappedSections[i].sectionLabel){
-            SectionTables[k][l].virtualAddress = mappedSections[i].startAddress+ offset;
-            offset+= SectionTables[k][l].length;
-            // moving free space further
-            if(SectionTables[k][l].virtualAddress + SectionTables[k][l].length > initialFreeSpace)
-              initialFreeSpace = SectionTables[k][l].virtualAddress + SectionTables[k][l].length;
-            break;
-          }
-        }    
-    }
-  }
-  for(auto i = 0; i< mappedSections.size() -1 ; i++){
-    for(auto j = i+1; j< mappedSections.size();j++){
-      if (overlapingSections(mappedSections[i], mappedSections[j])){
+  }
+
+  auto align = [this](uint64_t address){ return (address + SectionAlignment - 1) / SectionAlignment * SectionAlignment; };
+
+  if(!fillGaps){
+    // remaining sections follow the placed ones
+    uint64_t freeSpace = placed.empty() ? 0 : placed.back().end;
+    for(auto i= 0; i< AggregatedSectionTable.size(); i++){
+      if(isPlaced[i]) continue;
+      uint64_t start = align(freeSpace);
+      if(start + AggregatedSectionTable[i].length > MemoryMappedRegistersAddress){
         errorDetected = true;
-        cout<<"Placed sections " << mappedSections[i].sectionLabel << " and " << 
-          mappedSections[j].sectionLabel << " are overlapping." << endl;
-          return;
+        cout<<"No space left for section "<< AggregatedSectionTable[i].name<< "."<<endl;
+        return;
       }
+      AggregatedSectionTable[i].virtualAddress = start;
+      freeSpace = start + AggregatedSectionTable[i].length;
     }
+    return;
+  }
+
+  // free gaps as {usable size, aligned start}, the smallest one a section fits in is taken
+  set<pair<uint64_t, uint64_t>> gaps;
+  auto addGap = [&](uint64_t start, uint64_t end){
+    start = align(start);
+    if(start < end) gaps.insert({end - start, start});
+  };
+  uint64_t previousEnd = 0;
+  for(Interval &interval: placed){
+    addGap(previousEnd, interval.start);
+    previousEnd = interval.end;
   }
+  addGap(previousEnd, MemoryMappedRegistersAddress);
+
   for(auto i= 0; i< AggregatedSectionTable.size(); i++){
-    int32_t index = -1;
-    for(auto j = 0; j< mappedSections.size(); j++){
-      if (mappedSections[j].sectionLabel == AggregatedSectionTable[i].name){
-        index = i;
-        break;
-      }
+    if(isPlaced[i]) continue;
+    uint32_t length = AggregatedSectionTable[i].length;
+    if(length == 0){
+      AggregatedSectionTable[i].virtualAddress = 0;
+      continue;
     }
-    if (index == -1){
-      AggregatedSectionTable[i].virtualAddress = initialFreeSpace;
-      initialFreeSpace+= AggregatedSectionTable[i].length;
+    set<pair<uint64_t, uint64_t>>::iterator gap = gaps.lower_bound({length, 0});
+    if(gap == gaps.end()){
+      errorDetected = true;
+      cout<<"No space left for section "<< AggregatedSectionTable[i].name<< "."<<endl;
+      return;
     }
+    uint64_t start = gap->second;
+    uint64_t end = gap->second + gap->first;
+    gaps.erase(gap);
+    AggregatedSectionTable[i].virtualAddress = start;
+    addGap(start + length, end);
   }
 }
 
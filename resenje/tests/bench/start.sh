@@ -0,0 +1,41 @@
+ASSEMBLER=assembler
+LINKER=linker
+
+# Links a large synthetic program with different numbers of linker threads.
+# usage: ./start.sh [files] [instructions per file] [sections]
+FILES=${1:-200}
+INSTRUCTIONS=${2:-2000}
+SECTIONS=${3:-16}
+
+WORK=$(mktemp -d)
+trap "rm -rf ${WORK}" EXIT
+
+# every file defines a global entry point, calls the entry of the next file and jumps around
+# its own labels, so the link has both local and global relocations in every section
+for i in $(seq 1 ${FILES}); do
+  {
+    echo ".global entry${i}"
+    echo ".extern entry$(( i % FILES + 1 ))"
+    echo ".section part$(( i % SECTIONS ))"
+    echo "entry${i}:"
+    for j in $(seq 1 $(( INSTRUCTIONS / 3 ))); do
+      echo "l${j}: ld \$0x${j}, %r1"
+      echo "  beq %r1, %r2, l${j}"
+      echo "  call entry$(( i % FILES + 1 ))"
+    done
+    echo "  ret"
+    echo ".end"
+  } > ${WORK}/f${i}.s
+done
+
+SOURCES=$(for i in $(seq 1 ${FILES}); do echo ${WORK}/f${i}.s; done)
+OBJECTS=$(for i in $(seq 1 ${FILES}); do echo ${WORK}/f${i}.o; done)
+
+../../${ASSEMBLER} ${SOURCES} > /dev/null
+
+for threads in 1 2 4 8 $(nproc); do
+  START=$(date +%s%N)
+  ../../${LINKER} -hex -threads=${threads} -place=part0@0x40000000 -o ${WORK}/program.hex ${OBJECTS} > /dev/null
+  END=$(date +%s%N)
+  echo "threads ${threads}: $(( (END - START) / 1000000 )) ms"
+done